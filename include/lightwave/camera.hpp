@@ -53,7 +53,17 @@ public:
      * [resolution().x() - 1, resolution.y() - 1].
      * @param rng A random number generator used to steer the sampling.
      */
-    CameraSample sample(const Point2i &pixel, Sampler &rng) const;
+    CameraSample sample(const Point2i &pixel, Sampler &rng) const {
+        return sample(pixel, m_resolution, rng);
+    }
+
+    /**
+     * @brief Samples the camera model for a given pixel of an image with a
+     * resolution other than that of the camera (e.g., for previews), which
+     * covers the same field of view.
+     */
+    CameraSample sample(const Point2i &pixel, const Vector2i &resolution,
+                        Sampler &rng) const;
 
     /**
      * @brief Samples a ray according to this camera model in world space
@@ -19,6 +19,16 @@
 #define LW_CPU_UNKNOWN
 #endif
 
+// SIMD
+#if defined(__SSE2__) || defined(_M_X64) ||                                    \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LW_SIMD_SSE
+#endif
+
+#if defined(__AVX__)
+#define LW_SIMD_AVX
+#endif
+
 // OS
 #if defined(__linux) || defined(linux)
 #define LW_OS_LINUX
@@ -128,6 +138,8 @@ class Object {
     /// @brief A unique identifier used to refer to the object in logs or
     /// filenames.
     std::string m_id;
+    /// @brief A hash of the definition of the object in the scene file.
+    uint64_t m_fingerprint = 0;
 
 public:
     /// @brief Returns the unique identifier used to refer to this object in
@@ -137,6 +149,14 @@ public:
     /// or filenames.
     void setId(const std::string &id) { m_id = id; }
 
+    /// @brief Returns a hash of the definition of this object in the scene
+    /// file, including its children and the files it refers to (or zero for
+    /// objects that have not been created from a scene file).
+    uint64_t fingerprint() const { return m_fingerprint; }
+    /// @brief Sets the hash of the definition of this object in the scene
+    /// file.
+    void setFingerprint(uint64_t fingerprint) { m_fingerprint = fingerprint; }
+
     /// @brief Returns a textual representation of this object, used for
     /// debugging.
     virtual std::string toString() const = 0;
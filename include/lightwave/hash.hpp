@@ -28,6 +28,14 @@ public:
         return *this;
     }
 
+    /// @brief Updates the state by hashing the characters of a given string
+    /// (followed by its length, so that concatenations hash differently).
+    fnv1a &operator<<(const std::string &data) {
+        for (char c : data)
+            operator<<(c);
+        return operator<<(uint64_t(data.size()));
+    }
+
     /// @brief Returns the current state of the hash function.
     operator uint64_t() { return hash; }
 };
@@ -92,9 +92,23 @@ public:
     /// @brief Saves the image as an EXR file at a given path.
     void saveAt(const std::filesystem::path &path) const;
 
-    /// @brief Saves the image at its default path, given by the @ref basePath
-    /// of this image and its @ref id .
-    void save() const { saveAt(m_basePath / (id() + ".exr")); }
+    /// @brief Returns the default path of the image, given by the @ref
+    /// basePath of this image and its @ref id (followed by an optional suffix).
+    std::filesystem::path defaultPath(const std::string &suffix = "") const {
+        return m_basePath / (id() + suffix + ".exr");
+    }
+
+    /// @brief Saves the image at its default path.
+    void save() const { saveAt(defaultPath()); }
+
+    /**
+     * @brief Saves several images of the same resolution as layers of a single
+     * EXR file, with channels named "<layer>.R", "<layer>.G" and "<layer>.B"
+     * (or just "R", "G" and "B" for a layer with empty name).
+     */
+    static void saveLayers(
+        const std::filesystem::path &path,
+        const std::vector<std::pair<std::string, const Image *>> &layers);
 
     /// @brief Multiplies the color of all pixels component-wise by a given
     /// scalar.
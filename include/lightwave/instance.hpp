@@ -40,6 +40,13 @@ class Instance : public Shape {
     /// @brief The transformation applied to the shape, leading from object
     /// coordinates to world coordinates.
     ref<Transform> m_transform;
+    /**
+     * @brief The inverse of m_transform as affine 3x4 matrix, leading from
+     * world coordinates to object coordinates. This is all that is needed to
+     * transform rays, and is cheaper to apply than the full homogeneous
+     * transform.
+     */
+    Matrix3x4 m_worldToObject;
     /// @brief Tracks whether this instance has been added to the scene, i.e.,
     /// could be hit by ray tracing.
     bool m_visible;
@@ -49,6 +56,8 @@ class Instance : public Shape {
     // ref<Texture> m_alpha;
     /// @brief Medium property for instance
     ref<Medium> m_medium;
+    /// @brief Identifies the instance in AOV images (see @ref setIndex).
+    int m_index;
 
     /// @brief Transforms the frame from object coordinates to world
     /// coordinates.
@@ -56,16 +65,29 @@ class Instance : public Shape {
 
     inline void getLocalFrame(SurfaceEvent &surf, const Vector &wo) const;
 
+    /// @brief Transforms a ray from world coordinates to object coordinates
+    /// (the direction will not be normalized).
+    Ray toObject(const Ray &worldRay) const {
+        Ray localRay(worldRay);
+        localRay.origin =
+            Point(m_worldToObject * Vector4(Vector(worldRay.origin), 1));
+        localRay.direction = m_worldToObject * Vector4(worldRay.direction, 0);
+        return localRay;
+    }
+
 public:
     Instance(const Properties &properties) : m_light(nullptr) {
         m_shape     = properties.getChild<Shape>();
         m_bsdf      = properties.getOptionalChild<Bsdf>();
         m_emission  = properties.getOptionalChild<Emission>();
         m_transform = properties.getOptionalChild<Transform>();
+        if (m_transform)
+            m_worldToObject = m_transform->inverseAffine();
         m_medium = properties.getOptionalChild<Medium>();
         m_normal    = properties.get<Texture>("normal", nullptr);
         // m_alpha     = properties.get<Texture>("alpha", nullptr);
         m_visible = false;
+        m_index   = 0;
     }
 
     /// @brief Returns the shape.
@@ -89,6 +111,13 @@ public:
     /// @brief Sets the visible flag of this instance to true.
     void markAsVisible() override { m_visible = true; }
 
+    /// @brief Returns the index of this instance within the scene, or zero if
+    /// none has been assigned (e.g., for instances nested in groups).
+    int index() const { return m_index; }
+    /// @brief Sets the index of this instance within the scene, which starts
+    /// at one and follows the order of the scene file.
+    void setIndex(int index) { m_index = index; }
+
     /// @brief Sets the parent light object that contains this instance.
     void setLight(Light *light) {
         if (m_light) {
@@ -111,10 +140,18 @@ public:
      */
     bool intersect(const Ray &ray, Intersection &its,
                    Sampler &rng) const override;
+    /**
+     * @brief Tests whether the instance blocks a ray in world coordinates
+     * closer than @c tMax , without computing any surface attributes.
+     */
+    bool occluded(const Ray &ray, float tMax, Sampler &rng) const override;
     /// @brief Returns the bounding box of the instance in world coordinates.
     Bounds getBoundingBox() const override;
     /// @brief Returns the centroid of the instance in world coordinates.
     Point getCentroid() const override;
+    /// @brief Returns a cone containing the normals of the instance in world
+    /// coordinates.
+    DirectionCone getNormalCone() const override;
     /**
      * @brief Samples a point in world coordinates on the surface of this
      * instance.
@@ -12,8 +12,134 @@
 #include <lightwave/sampler.hpp>
 #include <lightwave/scene.hpp>
 
+#include <array>
+
 namespace lightwave {
 
+/// @brief Whether sampling integrators continue from their checkpoint files
+/// (if any), as requested by the @c --resume command line option.
+extern bool resumeFromCheckpoints;
+
+/**
+ * @brief Selects the part of an image that a process renders when the work of
+ * rendering is shared by several processes (possibly on different machines),
+ * as given by command line options. The parts are then written as partial
+ * renders, which can be merged into the final image.
+ */
+struct RenderPartition {
+    /// @brief Out of every @c blockCount blocks, only the block with offset
+    /// @c blockIndex is rendered (set by @c --tiles index/count ).
+    int blockIndex = 0;
+    int blockCount = 1;
+    /// @brief Only samples with index in [firstSample, lastSample) are
+    /// rendered, or all samples if @c lastSample is negative (set by
+    /// @c --samples first:last ).
+    int firstSample = 0;
+    int lastSample  = -1;
+    /// @brief Only pixels within this region are rendered, or all pixels if
+    /// the region is empty (set by @c --region x0,y0,x1,y1 ).
+    Bounds2i region;
+
+    /// @brief Whether only a part of the image is rendered.
+    bool isPartial() const {
+        return blockCount > 1 || firstSample > 0 || lastSample >= 0 ||
+               !region.isEmpty();
+    }
+
+    /// @brief A suffix for file names that identifies this part.
+    std::string suffix() const;
+};
+
+/// @brief The part of images that sampling integrators render.
+extern RenderPartition renderPartition;
+
+/**
+ * @brief A rectangle of the image that is rendered instead of the whole image
+ * (e.g., to render a problem area again), given either in pixels or relative
+ * to the resolution of the camera. The rendered image only contains the
+ * pixels of the rectangle, which receive exactly the same samples as in a
+ * render of the whole image.
+ */
+struct CropWindow {
+    /// @brief The rectangle, or an empty rectangle to render the whole image.
+    Bounds2 bounds;
+    /// @brief Whether the rectangle is given relative to the resolution (i.e.,
+    /// in [0,1]) instead of in pixels.
+    bool isNormalized = false;
+
+    /// @brief Whether the whole image is rendered.
+    bool isEmpty() const { return bounds.isEmpty(); }
+
+    /// @brief Returns the pixels covered by the rectangle for a given
+    /// resolution (clipped to the image).
+    Bounds2i pixels(const Vector2i &resolution) const;
+
+    /**
+     * @brief Parses a rectangle of the form "x0,y0,x1,y1", which is in
+     * pixels unless all values lie in [0,1] and some value has a decimal point
+     * (e.g., "0.25,0.25,0.5,0.5" is relative to the resolution).
+     */
+    static CropWindow parse(const std::string &value);
+};
+
+/**
+ * @brief Settings of a render job that replace those given by the scene file,
+ * as requested from the render server (see @c --serve ) or the command line.
+ */
+struct RenderOverrides {
+    /// @brief Only the camera with this id is rendered, or all cameras if
+    /// empty.
+    std::string camera;
+    /// @brief The number of samples per pixel, or zero to use the count of
+    /// the sampler.
+    int samplesPerPixel = 0;
+    /// @brief The resolution of the rendered images, or zero to use that of
+    /// the cameras. The field of view of the cameras stays the same.
+    Vector2i resolution{ 0 };
+    /// @brief The path that the image (of the first rendered camera) is saved
+    /// to, or empty to save it to its default path. The images of further
+    /// cameras are stored next to it.
+    std::filesystem::path output;
+    /// @brief The rectangle of the images that is rendered, or empty to use
+    /// that of the integrator (set by @c --crop x0,y0,x1,y1 ).
+    CropWindow crop;
+};
+
+/// @brief The settings that sampling integrators use instead of those of the
+/// scene file.
+extern RenderOverrides renderOverrides;
+
+/**
+ * @brief Auxiliary quantities (arbitrary output variables) of the first
+ * surface hit by camera rays, which sampling integrators can write to images
+ * of their own alongside the rendered image, e.g., as guides for denoising.
+ */
+enum class Aov {
+    /// @brief The albedo of the material that was hit.
+    Albedo,
+    /// @brief The shading normal in world coordinates (zero for misses).
+    Normals,
+    /// @brief The distance along the camera ray, i.e., the depth (zero for
+    /// misses).
+    Distance,
+    /// @brief The index of the instance that was hit, starting at one for the
+    /// first instance of the scene (zero for misses and nested instances).
+    /// Only the first sample of each pixel is recorded, as the mean of indices
+    /// would not identify any instance.
+    Instance,
+    /// @brief The number of BVH nodes (red) and shapes (green) that have been
+    /// tested for intersection.
+    Bvh,
+    Count
+};
+
+/// @brief The number of different AOVs.
+static constexpr int AovCount = int(Aov::Count);
+
+/// @brief Whether an AOV holds the mean of all samples of a pixel, as opposed
+/// to the value of its first sample.
+constexpr bool isAveraged(Aov aov) { return aov != Aov::Instance; }
+
 /**
  * @brief Integrators are rendering algorithms that take a scene and produce an
  * image from them (e.g., using path tracing). The term integrator refers to the
@@ -39,12 +165,183 @@ protected:
     ref<Image> m_image;
     /// @brief The scene that should be rendered.
     ref<Scene> m_scene;
+    /// @brief Whether the entire image is rendered in passes of few samples
+    /// each, which allows previewing the image early and stopping the render
+    /// at any pass, instead of rendering one block after another.
+    bool m_progressive;
+    /// @brief The number of samples per pixel of each progressive pass.
+    int m_samplesPerPass;
+    /**
+     * @brief Whether regions of the image stop receiving samples once their
+     * estimated relative error falls below @c m_threshold . The samples saved
+     * this way are spent on the remaining (noisy) regions instead.
+     * Implies progressive rendering.
+     */
+    bool m_adaptive;
+    /// @brief The relative error at which adaptive sampling considers a
+    /// region converged.
+    float m_threshold;
+    /// @brief The number of samples per pixel before adaptive sampling
+    /// estimates the error of a region for the first time.
+    int m_minSamples;
+    /// @brief The maximum number of samples per pixel with adaptive sampling.
+    int m_maxSamples;
+    /**
+     * @brief The time in seconds that rendering (each view) may take, or zero
+     * if the number of samples is given by the sampler instead.
+     * Rendering is progressive and continues with further passes as long as
+     * they are expected to finish before the deadline. Implies progressive
+     * rendering.
+     */
+    float m_timeBudget;
+    /**
+     * @brief The interval in seconds in which the state of rendering is saved
+     * to a checkpoint file, or zero to disable checkpoints.
+     * A checkpoint is also written when rendering is stopped early. Implies
+     * progressive rendering.
+     * @see resumeFromCheckpoints
+     */
+    float m_checkpointInterval;
+    /**
+     * @brief The images that AOVs are written to (or null for AOVs that are
+     * not needed), given as named images ("albedo", "normals", "distance",
+     * "instance" and "bvh"). The AOVs are averaged over all samples of a
+     * pixel just like the rendered image, and additionally stored in a single
+     * multi-channel EXR file next to it.
+     */
+    std::array<ref<Image>, AovCount> m_aovs;
+    /// @brief The rectangle of the image that is rendered (given as string
+    /// "x0,y0,x1,y1" by the @c crop property, see @ref CropWindow).
+    CropWindow m_crop;
+    /// @brief A hash of the attributes of the integrator that affect the
+    /// rendered image (e.g., the path depth), which checkpoints are tied to.
+    uint64_t m_attributeFingerprint;
+
+    /// @brief The names of the AOVs, as used for properties and EXR layers.
+    static const std::array<const char *, AovCount> AovNames;
+
+    /// @brief A camera of the scene together with the images that are
+    /// rendered from it.
+    struct View {
+        const Camera *camera;
+        /// @brief The resolution that the camera renders at, which can differ
+        /// from that of the camera (see @ref RenderOverrides).
+        Vector2i resolution;
+        /// @brief The pixels that are rendered, which are stored with the
+        /// minimum of this rectangle at the origin of the images.
+        Bounds2i crop;
+        ref<Image> image;
+        std::array<ref<Image>, AovCount> aovs;
+
+        /// @brief The resolution of the images.
+        Vector2i size() const { return crop.diagonal(); }
+    };
+    /**
+     * @brief The views that are rendered, one for each camera of the scene.
+     * The first view renders into the images of the integrator, the others
+     * into images stored next to them, whose names are suffixed by the id of
+     * the camera (or "_view" and the index of the camera if it has no id).
+     */
+    std::vector<View> m_views;
+
+    /// @brief Whether any AOV is written.
+    bool hasAovs() const {
+        return std::any_of(m_aovs.begin(), m_aovs.end(), [](const auto &aov) {
+            return aov != nullptr;
+        });
+    }
+
+    /**
+     * @brief Records the AOVs of the first surface hit by the camera ray of
+     * the sample that is currently being rendered. Integrators call this
+     * with the first intersection of their camera ray, which saves tracing it
+     * a second time (the intersection is only recorded once per sample, so
+     * later calls are ignored). Without such a call, the camera ray is traced
+     * again after @ref Li returns.
+     */
+    void recordAovs(const Intersection &its) const;
+    /// @brief Saves the AOV images of a view, as well as all its images as
+    /// layers of a single EXR file.
+    void saveAovs(const View &view) const;
+
+    /// @brief Parses a duration such as "300s", "5m", "1.5h" or "20" (which
+    /// is in seconds) into seconds.
+    static float parseDuration(const std::string &value);
+
+    /**
+     * @brief Renders the images of all views one block after another, with
+     * all samples per pixel at once.
+     * The blocks of all views are scheduled together, so that no thread idles
+     * while the last blocks of one view are being finished.
+     * If only a part of the image is to be rendered (see @ref
+     * renderPartition), the unnormalized result is saved as partial render.
+     */
+    void renderBlocks();
+    /**
+     * @brief Renders the image of a view in passes over all pixels, until
+     * either all samples are done or the user requests to stop (by pressing
+     * Ctrl+C).
+     * @return Whether the render was completed (i.e., not stopped early).
+     */
+    bool renderProgressive(const View &view);
+    /// @brief The path of the checkpoint file of a view, which is stored next
+    /// to its output image.
+    std::filesystem::path checkpointPath(const View &view) const;
+
+    /// @brief The number of samples per pixel that are rendered (see @ref
+    /// RenderOverrides).
+    int samplesPerPixel() const {
+        return renderOverrides.samplesPerPixel > 0
+                   ? renderOverrides.samplesPerPixel
+                   : m_sampler->samplesPerPixel();
+    }
+
+    /**
+     * @brief Returns the sum of the radiance samples @c firstSample to
+     * @code firstSample + sampleCount - 1 @endcode of a pixel of the images
+     * of a view.
+     * As each sample is seeded by its index, rendering the samples of a pixel
+     * in several parts produces the same result as rendering them all at once.
+     * @param squaredLuminance If given, the squared luminance of each sample
+     * is added to it (which allows estimating the variance of the pixel).
+     * @param aovSums If given, the AOVs of each sample are added to these
+     * @ref AovCount values (except for AOVs that are not averaged, which are
+     * set by the first sample of the pixel, see @ref isAveraged ).
+     */
+    Color renderSamples(const View &view, const Point2i &pixel,
+                        int firstSample, int sampleCount, Sampler &rng,
+                        float *squaredLuminance = nullptr,
+                        Color *aovSums = nullptr);
 
 public:
     SamplingIntegrator(const Properties &properties) : Integrator(properties) {
         m_sampler = properties.getChild<Sampler>();
         m_image   = properties.getOptionalChild<Image>();
         m_scene   = properties.getChild<Scene>();
+
+        m_progressive    = properties.get<bool>("progressive", false);
+        m_samplesPerPass = properties.get<int>("passSamples", 1);
+        if (m_samplesPerPass < 1)
+            lightwave_throw("passSamples must be positive");
+
+        m_adaptive   = properties.get<bool>("adaptive", false);
+        m_threshold  = properties.get<float>("threshold", 0.02f);
+        m_minSamples = properties.get<int>("minSamples", 16);
+        m_maxSamples = properties.get<int>(
+            "maxSamples", 8 * m_sampler->samplesPerPixel());
+        m_timeBudget =
+            parseDuration(properties.get<std::string>("budget", "0s"));
+        m_checkpointInterval =
+            parseDuration(properties.get<std::string>("checkpoint", "0s"));
+
+        for (int aov = 0; aov < AovCount; aov++)
+            m_aovs[aov] = properties.get<Image>(AovNames[aov], nullptr);
+
+        m_crop = CropWindow::parse(properties.get<std::string>("crop", ""));
+
+        // the time spent rendering does not affect the samples taken
+        m_attributeFingerprint =
+            properties.fingerprint({ "budget", "checkpoint" });
     }
 
     /// @brief Sets the output image that should be populated by rendering.
@@ -58,8 +355,8 @@ public:
     /// decisions.
     Sampler *sampler() { return m_sampler.get(); }
 
-    /// @brief Computes all pixels of the image by constructing camera rays for
-    /// them and invoking the @ref Li method.
+    /// @brief Computes all pixels of the image (of each camera of the scene)
+    /// by constructing camera rays for them and invoking the @ref Li method.
     void execute() override;
 
     /**
@@ -10,6 +10,8 @@
 #include <lightwave/emission.hpp>
 #include <lightwave/math.hpp>
 
+#include <optional>
+
 namespace lightwave {
 
 /// @brief The result of sampling a light from a given query point using @ref
@@ -44,6 +46,42 @@ struct DirectLightSample {
     explicit operator bool() const { return !isInvalid(); }
 };
 
+/**
+ * @brief Bounds the emission of a light source in space and direction, which
+ * allows estimating how much light it can contribute to a point without
+ * sampling it (see @ref Scene::sampleLight ).
+ */
+struct LightBounds {
+    /// @brief The region of space that emits light.
+    Bounds bounds;
+    /// @brief Contains the normals of all emitting surfaces (all directions
+    /// for point lights).
+    DirectionCone normals = DirectionCone::empty();
+    /// @brief The cosine of the largest angle between a normal and a direction
+    /// that light is emitted in (zero for Lambertian emitters).
+    float cosThetaEmission = 1;
+    /// @brief The total emitted power (see @ref Light::power ), scaled by the
+    /// sampling weight of the light.
+    float power = 0;
+
+    /// @brief Returns bounds that contain the emission of both given bounds.
+    static LightBounds merge(const LightBounds &a, const LightBounds &b) {
+        if (a.power == 0)
+            return b;
+        if (b.power == 0)
+            return a;
+        Bounds bounds = a.bounds;
+        bounds.extend(b.bounds);
+        return {
+            .bounds           = bounds,
+            .normals          = DirectionCone::merge(a.normals, b.normals),
+            .cosThetaEmission = std::min(a.cosThetaEmission,
+                                         b.cosThetaEmission),
+            .power            = a.power + b.power,
+        };
+    }
+};
+
 /**
  * @brief A light source that can be sampled for direct connections.
  * Some light sources can also be intersected by rays (e.g., area lights or the
@@ -59,6 +97,9 @@ protected:
      * divided by the total weight of all light sources in the scene.
      */
     float m_samplingWeight;
+    /// @brief The position of this light within the lights of its scene (see
+    /// @ref setIndex), or -1 if it is not part of a scene.
+    int m_index = -1;
 
 public:
     Light(const Properties &properties) {
@@ -73,6 +114,20 @@ public:
      */
     float samplingWeight() const { return m_samplingWeight; }
 
+    /// @brief Returns the position of this light within the lights of its
+    /// scene, which allows looking up per-light data without hashing.
+    int index() const { return m_index; }
+    /// @brief Sets the position of this light within the lights of its scene.
+    void setIndex(int index) { m_index = index; }
+
+    /**
+     * @brief Returns the total power emitted by this light (as luminance),
+     * which is used to pick bright lights more often than dim ones.
+     * @param sceneBounds The bounds of the scene, which determine how much
+     * light reaches the scene from lights that are infinitely far away.
+     */
+    virtual float power(const Bounds &sceneBounds) const = 0;
+
     /**
      * @brief Samples a random point on the light source and computes its
      * emission and probability of sampling.
@@ -90,6 +145,13 @@ public:
     /// @brief Returns whether this light source can be hit by rays (i.e., has
     /// an area that has been placed within the scene).
     virtual bool canBeIntersected() const { return false; }
+
+    /**
+     * @brief Returns bounds of the emission of this light, or nothing if the
+     * light is infinitely far away (e.g., directional and background lights),
+     * in which case its contribution cannot be estimated from its position.
+     */
+    virtual std::optional<LightBounds> bounds() const { return std::nullopt; }
 };
 
 /**
@@ -111,6 +173,16 @@ public:
      */
     virtual EmissionEval evaluate(const Vector &direction) const = 0;
 
+    /**
+     * @brief Returns the density (in solid angle) with which @ref sampleDirect
+     * samples a given direction, which is needed to weight rays that escape
+     * the scene by multiple importance sampling. Background lights that
+     * cannot be sampled report a density of zero.
+     * @param direction The direction in world coordinates, pointing away from
+     * the scene.
+     */
+    virtual float pdf(const Vector &direction) const { return 0; }
+
     DirectLightSample sampleDirect(const Point &origin,
                                    Sampler &rng) const override {
         return DirectLightSample::invalid();
@@ -6,6 +6,7 @@
 #pragma once
 
 #include <atomic>
+#include <functional>
 #include <lightwave/core.hpp>
 #include <mutex>
 
@@ -27,6 +28,10 @@ class Logger {
     /// @brief A status message to be shown at the bottom of console output
     /// (e.g., render progress in percent).
     std::string m_status;
+    /// @brief Notified about the progress of tasks (e.g., to forward it to
+    /// clients of the render server), if set.
+    std::function<void(const std::string &task, float progress)>
+        m_progressListener;
 
 public:
     /// @brief Logs a message to console output, which will be constructed from
@@ -65,6 +70,30 @@ public:
         m_status = tfm::format(fmt, args...);
         std::cout << "\033[2K\r" << m_status << std::flush;
     }
+
+    /// @brief Sets the function that is notified about the progress of tasks
+    /// (or null to disable notifications).
+    void setProgressListener(
+        std::function<void(const std::string &task, float progress)>
+            listener) {
+        std::unique_lock lock{ m_mutex };
+        m_progressListener = std::move(listener);
+    }
+
+    /// @brief Notifies the progress listener (if any) about the progress of a
+    /// task, given as fraction in [0,1].
+    /// @note The listener is called without holding the lock of the logger, as
+    /// it might block (e.g., on a client that does not read its replies), and
+    /// hence needs to synchronize itself.
+    void reportProgress(const std::string &task, float progress) {
+        std::function<void(const std::string &task, float progress)> listener;
+        {
+            std::unique_lock lock{ m_mutex };
+            listener = m_progressListener;
+        }
+        if (listener)
+            listener(task, progress);
+    }
 };
 
 /// @brief The interface used to log messages to console output.
@@ -132,6 +161,7 @@ public:
             100 * progress,
             elapsedTime,
             elapsedTime * (1 - progress) / progress);
+        logger.reportProgress(m_name, progress);
     }
 
     /// @brief Marks a number of @c unitsCompleted as completed and notifies the
@@ -705,6 +705,9 @@ using Vector3i = TVector<int, 3>;
 /// homogeneous coordinates).
 using Vector4 = TVector<float, 4>;
 
+/// @brief A floating point rectangle (e.g., to describe a region of an image
+/// relative to its size).
+using Bounds2 = TBounds<float, 2>;
 /// @brief An integer rectangle (e.g., to describe the blocks of an image).
 using Bounds2i = TBounds<int, 2>;
 /// @brief A three-dimensional axis-aligned bounding box with floating point
@@ -713,6 +716,9 @@ using Bounds = TBounds<float, 3>;
 
 /// @brief A 3x3 matrix with floating point components.
 using Matrix3x3 = TMatrix<float, 3, 3>;
+/// @brief A 3x4 matrix with floating point components (used for affine
+/// transforms, whose last row in homogeneous coordinates is implicit).
+using Matrix3x4 = TMatrix<float, 3, 4>;
 /// @brief A 4x4 matrix with floating point components (used for homogeneous
 /// coordinates).
 using Matrix4x4 = TMatrix<float, 4, 4>;
@@ -878,6 +884,56 @@ struct Frame {
     void validate() const;
 };
 
+/**
+ * @brief A cone of directions around an axis, given by the cosine of its
+ * half-angle (e.g., to bound the normals of a surface).
+ */
+struct DirectionCone {
+    /// @brief The axis of the cone (normalized).
+    Vector axis;
+    /// @brief The cosine of the angle between the axis and the boundary of
+    /// the cone (one for a single direction, minus one for all directions).
+    float cosTheta;
+
+    /// @brief A cone that contains no direction.
+    static DirectionCone empty() { return { Vector(0, 0, 1), Infinity }; }
+    /// @brief A cone that contains all directions.
+    static DirectionCone entireSphere() { return { Vector(0, 0, 1), -1 }; }
+
+    bool isEmpty() const { return cosTheta == Infinity; }
+
+    /// @brief Returns the smallest cone that contains both given cones.
+    static DirectionCone merge(const DirectionCone &a,
+                               const DirectionCone &b) {
+        if (a.isEmpty())
+            return b;
+        if (b.isEmpty())
+            return a;
+
+        // one cone might already contain the other one
+        const float thetaA = safe_acos(a.cosTheta);
+        const float thetaB = safe_acos(b.cosTheta);
+        const float thetaD = safe_acos(a.axis.dot(b.axis));
+        if (std::min(thetaD + thetaB, Pi) <= thetaA)
+            return a;
+        if (std::min(thetaD + thetaA, Pi) <= thetaB)
+            return b;
+
+        // otherwise, the axis is rotated from a towards b
+        const float theta = (thetaA + thetaD + thetaB) / 2;
+        if (theta >= Pi)
+            return entireSphere();
+        const Vector rotationAxis = a.axis.cross(b.axis);
+        if (rotationAxis.lengthSquared() == 0)
+            return entireSphere();
+        const float rotation   = theta - thetaA;
+        const Vector bitangent = rotationAxis.normalized().cross(a.axis);
+        const Vector axis =
+            a.axis * std::cos(rotation) + bitangent * std::sin(rotation);
+        return { axis.normalized(), std::cos(theta) };
+    }
+};
+
 /// @brief Barycentric interpolation ([0,0] returns a, [1,0] returns b, and
 /// [0,1] returns c).
 template <typename T>
@@ -953,17 +1009,26 @@ struct Intersection : public SurfaceEvent {
     /// @brief The intersection distance, which can also be used to specify a
     /// maximum distance when querying intersections.
     float t;
-    /**
-     * @brief The probability of having picked the intersected light source
-     * using
-     * @c Scene::sampleLight , or zero if no light source was intersected.
-     */
-    float lightProbability;
     /**
      * @brief The background of the scene, only set in case no object was hit
      * and the scene has defined one.
      */
     BackgroundLight *background = nullptr;
+    /**
+     * @brief Whether shapes need to compute the density of sampling the hit
+     * point (see @ref SurfaceEvent::pdf ), which is only the case for hits on
+     * area lights. Set by instances while their shape is intersected.
+     */
+    bool needsPdf = false;
+
+    /**
+     * @brief The primitive that was hit (e.g., the triangle of a mesh) and the
+     * barycentric coordinates of the hitpoint on it. Shapes record these while
+     * searching for the closest hit, so that surface attributes only need to
+     * be computed once for the final hit.
+     */
+    int primitiveIndex = -1;
+    Vector2 barycentric;
 
     /// @brief Statistics recorded while traversing acceleration structures.
     struct {
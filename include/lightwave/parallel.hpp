@@ -5,8 +5,16 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <future>
+#include <memory>
 #include <mutex>
 #include <thread>
+#include <vector>
 
 #include <lightwave/color.hpp>
 #include <lightwave/logger.hpp>
@@ -19,6 +27,97 @@
 
 namespace lightwave {
 
+/**
+ * @brief A persistent pool of worker threads that is shared by the entire
+ * process, so that rendering, building acceleration structures and loading
+ * scenes neither create threads over and over again nor compete for the cores
+ * with separate sets of threads.
+ *
+ * Each worker owns a queue of tasks. It executes the most recently added task
+ * of its own queue first, and steals the oldest tasks of other queues when it
+ * runs out of work. Tasks submitted by threads outside of the pool (such as
+ * the main thread) are placed in a shared queue, which is processed in order.
+ */
+class ThreadPool {
+public:
+    using Task = std::function<void()>;
+
+    /// @brief Creates a pool with the given number of worker threads.
+    explicit ThreadPool(int numThreads);
+    ThreadPool(const ThreadPool &)            = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+    /// @brief Stops all workers once they have finished their current task.
+    ~ThreadPool();
+
+    /// @brief The pool shared by the entire process, with one worker thread
+    /// per core.
+    static ThreadPool &global();
+
+    /// @brief The number of worker threads of this pool.
+    int numThreads() const { return int(m_threads.size()); }
+
+    /// @brief Schedules a task for execution by one of the workers.
+    void submit(Task task);
+
+    /// @brief Schedules a function for execution by one of the workers, and
+    /// returns a future for its result.
+    template <class Function>
+    auto async(Function function)
+        -> std::future<std::invoke_result_t<Function>> {
+        using Result = std::invoke_result_t<Function>;
+        // std::function requires copyable targets, packaged tasks are not
+        auto task = std::make_shared<std::packaged_task<Result()>>(
+            std::move(function));
+        auto future = task->get_future();
+        submit([task]() { (*task)(); });
+        return future;
+    }
+
+    /**
+     * @brief Invokes @c body for all indices in [0, count), in parallel across
+     * the calling thread and the workers of the pool, and returns once all
+     * invocations have finished. The first exception thrown by @c body is
+     * rethrown to the caller.
+     * @note Indices are handed out in increasing order, so earlier indices
+     * tend to finish first.
+     */
+    void parallelFor(int count, const std::function<void(int)> &body);
+
+private:
+    /// @brief A queue of tasks, which is owned by one worker.
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        /// @brief Tasks that help with a @ref parallelFor . Unlike other tasks,
+        /// they never wait for other tasks, and can hence be run by workers
+        /// that wait for a @ref parallelFor to finish.
+        std::deque<Task> helpers;
+    };
+
+    /// @brief Schedules a task, see @ref Queue::helpers .
+    void enqueue(Task task, bool isHelper);
+    /// @brief Takes a task from the queues, preferring the given queue.
+    bool pop(int queueIndex, bool helpersOnly, Task &task);
+    void work(int workerIndex);
+
+    /// @brief One queue per worker, followed by the queue for external
+    /// threads.
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::vector<std::thread> m_threads;
+
+    /// @brief Used by idle workers to wait for new tasks, and guards the
+    /// counts of pending tasks.
+    std::mutex m_idleMutex;
+    std::condition_variable m_idle;
+    /// @brief Used by workers that wait for a @ref parallelFor to finish.
+    std::condition_variable m_waiting;
+    /// @brief The number of tasks that are waiting in queues.
+    int m_pendingTasks = 0;
+    /// @brief The number of helper tasks among them.
+    int m_pendingHelpers = 0;
+    bool m_stopping      = false;
+};
+
 /// @brief Invokes @c f for each element of the iterator, parallelized across
 /// all available cores.
 template <class ForwardIt, class UnaryFunction>
@@ -28,43 +127,25 @@ void for_each_parallel(ForwardIt first, ForwardIt last, UnaryFunction f) {
     return;
 #endif
 
-    std::mutex m_lock;
-
-    const int numThreads = std::thread::hardware_concurrency();
-    std::vector<std::thread> m_threads;
-    m_threads.reserve(numThreads);
-
-    // build a thread pool
-    for (int i = 0; i < numThreads; i++) {
-        m_threads.emplace_back([&]() {
-            while (true) {
-                m_lock.lock();
-                if (!(first != last)) {
-                    // no more work to do
-                    m_lock.unlock();
-                    break;
-                }
-
-                // grab a work item
-                auto obj = *first;
-                ++first;
-                m_lock.unlock();
-
-                // execute the work item
-                f(obj);
-            }
-        });
+    if constexpr (std::random_access_iterator<ForwardIt>) {
+        ThreadPool::global().parallelFor(
+            int(last - first), [&](int index) { f(first[index]); });
+    } else {
+        // gather the work items upfront, which allows workers to claim them
+        // without holding a lock
+        std::vector<std::decay_t<decltype(*first)>> items;
+        for (; first != last; ++first)
+            items.push_back(*first);
+
+        ThreadPool::global().parallelFor(int(items.size()),
+                                         [&](int index) { f(items[index]); });
     }
-
-    // wait until all threads have finished
-    for (auto &thread : m_threads)
-        thread.join();
 }
 
 /// @brief Invokes @c f for each element of the iterator, parallelized across
 /// all available cores.
 template <class Iterator, class UnaryFunction>
-void for_each_parallel(Iterator it, UnaryFunction f) {
+void for_each_parallel(Iterator &&it, UnaryFunction f) {
     for_each_parallel(it.begin(), it.end(), f);
 }
 
@@ -8,6 +8,7 @@
 
 #include <lightwave/color.hpp>
 #include <lightwave/core.hpp>
+#include <lightwave/hash.hpp>
 
 #include <filesystem>
 #include <map>
@@ -121,6 +122,23 @@ public:
         }
     }
 
+    /**
+     * @brief Returns a hash of the attributes of the node (except the given
+     * ones), which identifies how the object has been configured.
+     * @note Attributes that refer to objects are skipped, as their
+     * configuration is not known here.
+     */
+    uint64_t fingerprint(const std::set<std::string> &ignored = {}) const {
+        hash::fnv1a result;
+        for (const auto &[name, value] : m_attributes) {
+            if (ignored.contains(name) ||
+                std::holds_alternative<ref<Object>>(value))
+                continue;
+            result << name << toString(value);
+        }
+        return result;
+    }
+
     /// @brief Checks whether a given attribute is present.
     bool has(const std::string &name) const {
         return m_attributes.find(name) != m_attributes.end();
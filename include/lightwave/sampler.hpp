@@ -51,6 +51,15 @@ public:
      * are expected to give different random sequences.
      */
     virtual void seed(const Point2i &pixel, int sampleIndex) = 0;
+    /**
+     * @brief Informs the sampler that the random numbers that follow are used
+     * for the given bounce of a path (starting at zero for the first
+     * intersection, the numbers before are used by the camera).
+     * Samplers that stratify each dimension across the samples of a pixel
+     * use this to give every bounce the same dimensions in all samples, no
+     * matter how many numbers previous bounces have consumed.
+     */
+    virtual void startBounce(int depth) {}
     /// @brief Returns an identical copy of the sampler, e.g., for use in
     /// different threads.
     virtual ref<Sampler> clone() const = 0;
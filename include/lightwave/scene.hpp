@@ -6,6 +6,7 @@
 #pragma once
 
 #include <lightwave/core.hpp>
+
 #include <vector>
 
 namespace lightwave {
@@ -31,11 +32,18 @@ struct LightSample {
     explicit operator bool() const { return !isInvalid(); }
 };
 
-/// @brief Scenes are the input to rendering algorithms: They contain all
-/// geometry, materials, lights and the camera.
+class LightBVH;
+
+/**
+ * @brief Scenes are the input to rendering algorithms: They contain all
+ * geometry, materials, lights and the cameras.
+ * @note A scene can have several cameras (e.g., for turntables), which are
+ * all rendered by the same integrator and share everything else.
+ */
 class Scene : public Object {
-    /// @brief The camera from which the image is to be rendered.
-    ref<Camera> m_camera;
+    /// @brief The cameras from which images are to be rendered, in the order
+    /// of the scene file.
+    std::vector<ref<Camera>> m_cameras;
     /// @brief The geometry of the scene that should be rendered (typically an
     /// acceleration structure with instances in it).
     ref<Shape> m_shape;
@@ -52,13 +60,19 @@ class Scene : public Object {
     /// @brief Contains all necessary data structures to randomly pick light
     /// sources.
     ref<LightSampling> m_lightSampling;
+    /// @brief Picks lights depending on the point they illuminate, unless
+    /// disabled by the scene (in which case lights are picked by their
+    /// power only).
+    ref<LightBVH> m_lightHierarchy;
 
 public:
     Scene(const Properties &properties);
     std::string toString() const override;
 
-    /// @brief The camera from which the image is to be rendered.
-    Camera *camera() const { return m_camera.get(); }
+    /// @brief The (first) camera from which the image is to be rendered.
+    Camera *camera() const { return m_cameras.front().get(); }
+    /// @brief All cameras from which images are to be rendered.
+    const std::vector<ref<Camera>> &cameras() const { return m_cameras; }
 
     /// @brief Finds the closest intersection of the scene for a given ray.
     Intersection intersect(const Ray &ray, Sampler &rng) const;
@@ -69,10 +83,21 @@ public:
     /// @brief Reports whether at least one light exists that could be sampled.
     bool hasLights() const;
 
-    /// @brief Randomly picks a light from the list of sampleable light sources.
+    /// @brief Randomly picks a light from the list of sampleable light
+    /// sources, proportionally to their power times their sampling weight.
     LightSample sampleLight(Sampler &rng) const;
     /// @brief Returns the probability of randomly picking a light source via @ref sampleLight .
     float lightSelectionProbability(const Light *light) const;
+    /**
+     * @brief Randomly picks a light to illuminate a surface point, preferring
+     * lights that are likely to contribute much to it.
+     * @note Fails if no light can contribute to the point.
+     */
+    LightSample sampleLight(const SurfaceEvent &surface, Sampler &rng) const;
+    /// @brief Returns the probability of picking a light source for a surface
+    /// point via @ref sampleLight .
+    float lightSelectionProbability(const Light *light,
+                                    const SurfaceEvent &surface) const;
     /// @brief Returns the bounding box of the scene geometry.
     Bounds getBoundingBox() const;
 };
@@ -42,8 +42,29 @@ public:
      */
     virtual bool intersect(const Ray &ray, Intersection &its,
                            Sampler &rng) const = 0;
+    /**
+     * @brief Tests whether the shape has any intersection with a ray that is
+     * closer than @c tMax (used for testing visibility of light sources).
+     * Unlike @ref intersect , this can stop at the first intersection found and
+     * does not need to compute any surface attributes.
+     * @note The default implementation falls back to @ref intersect .
+     */
+    virtual bool occluded(const Ray &ray, float tMax, Sampler &rng) const {
+        Intersection its(-ray.direction, tMax);
+        return intersect(ray, its, rng);
+    }
     /// @brief Returns a bounding box that tightly encapsulates the shape.
     virtual Bounds getBoundingBox() const = 0;
+    /**
+     * @brief Returns a bounding box that encapsulates the shape after applying
+     * a transform to it.
+     * @note The default implementation transforms the corners of the
+     * untransformed bounding box, which gives loose bounds for rotations.
+     * Shapes that know more about their geometry can do better.
+     */
+    virtual Bounds getTransformedBoundingBox(const Transform &transform) const {
+        return transformBounds(getBoundingBox(), transform);
+    }
     /**
      * @brief Returns the center of the shape, which must lie somewhere within
      * the bounding box of this shape.
@@ -54,6 +75,14 @@ public:
      * partitioning objects (e.g., when building a BVH structure).
      */
     virtual Point getCentroid() const = 0;
+    /**
+     * @brief Returns a cone that contains the normals of all points on the
+     * shape, which is used to skip lights that face away from a point.
+     * @note The default implementation conservatively reports all directions.
+     */
+    virtual DirectionCone getNormalCone() const {
+        return DirectionCone::entireSphere();
+    }
     /// @brief Samples a random point on the surface of this shape.
     virtual AreaSample sampleArea(Sampler &rng) const = 0;
 
@@ -66,6 +95,29 @@ public:
      * tracing, if it is not also added to the scene using a reference.
      */
     virtual void markAsVisible() {}
+
+protected:
+    /// @brief Computes the bounding box of the eight transformed corners of a
+    /// bounding box.
+    static Bounds transformBounds(const Bounds &bounds,
+                                  const Transform &transform) {
+        if (bounds.isUnbounded()) {
+            return Bounds::full();
+        }
+
+        Bounds result;
+        for (int point = 0; point < 8; point++) {
+            Point p = bounds.min();
+            for (int dim = 0; dim < p.Dimension; dim++) {
+                if ((point >> dim) & 1) {
+                    p[dim] = bounds.max()[dim];
+                }
+            }
+            p = transform.apply(p);
+            result.extend(p);
+        }
+        return result;
+    }
 };
 
 } // namespace lightwave
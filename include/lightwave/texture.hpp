@@ -33,6 +33,13 @@ public:
         // interface for scalar values)
         return evaluate(uv).r();
     }
+
+    /**
+     * @brief Returns the resolution at which the texture varies, i.e., the
+     * number of pixels for image textures. Textures that are not based on an
+     * image report a single pixel.
+     */
+    virtual Point2i resolution() const { return Point2i(1); }
 };
 
 } // namespace lightwave
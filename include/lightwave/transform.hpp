@@ -188,6 +188,10 @@ public:
         m_inverse = m_inverse * matrix;
     }
 
+    /// @brief Returns the inverse transform as affine 3x4 matrix, i.e., without
+    /// the last row of the homogeneous matrix (which suffices for rays).
+    Matrix3x4 inverseAffine() const { return m_inverse.submatrix<3, 4>(0, 0); }
+
     /// @brief Returns the determinant of this transformation.
     float determinant() const {
         return m_transform.submatrix<3, 3>(0, 0).determinant();
@@ -7,6 +7,8 @@
 
 #include <lightwave/math.hpp>
 
+#include <vector>
+
 namespace lightwave {
 
 /**
@@ -121,4 +123,111 @@ inline float cosineHemispherePdf(const Vector &vector) {
     return InvPi * std::max(vector.z(), float(0));
 }
 
+/**
+ * @brief Warps a given point from the unit square ([0,0] to [1,1]) to the
+ * barycentric coordinates of a triangle (see @ref interpolateBarycentric ),
+ * such that the resulting points are uniformly distributed over its area.
+ * @see Based on Heitz, "A Low-Distortion Map Between Triangle and Square"
+ * (2019), which preserves the stratification of the samples.
+ */
+inline Vector2 squareToUniformTriangle(const Point2 &sample) {
+    if (sample.x() < sample.y()) {
+        const float offset = sample.x() / 2;
+        return { offset, sample.y() - offset };
+    }
+    const float offset = sample.y() / 2;
+    return { sample.x() - offset, offset };
+}
+
+/**
+ * @brief Picks indices with probabilities proportional to a list of weights in
+ * constant time, using the alias method of Vose, "A Linear Algorithm for
+ * Generating Random Numbers with a Given Distribution" (1991).
+ *
+ * Every index owns a bin of equal probability. A bin keeps its own index with
+ * some probability and otherwise forwards to its alias, which is an index
+ * whose weight exceeds the probability of a single bin.
+ */
+class AliasTable {
+    struct Bin {
+        /// @brief The probability of sampling the index of this bin.
+        float probability;
+        /// @brief The probability of keeping the index of this bin instead of
+        /// switching to its alias.
+        float threshold;
+        /// @brief The index that is picked otherwise.
+        int alias;
+    };
+
+    std::vector<Bin> m_bins;
+
+public:
+    /// @brief Creates an empty table that cannot be sampled.
+    AliasTable() {}
+
+    /// @brief Builds the table for the given non-negative weights, which is
+    /// left empty if no weight is positive.
+    explicit AliasTable(const std::vector<float> &weights) {
+        double totalWeight = 0;
+        for (float weight : weights)
+            totalWeight += weight;
+        if (!(totalWeight > 0))
+            return;
+
+        // the weights relative to the probability of a single bin
+        const int count = int(weights.size());
+        std::vector<double> scaled(count);
+        std::vector<int> small, large;
+        m_bins.resize(count);
+        for (int index = 0; index < count; index++) {
+            m_bins[index].probability = float(weights[index] / totalWeight);
+            scaled[index] = weights[index] / totalWeight * count;
+            (scaled[index] < 1 ? small : large).push_back(index);
+        }
+
+        // fill up each small bin with the probability of a large one
+        while (!small.empty() && !large.empty()) {
+            const int index = small.back();
+            const int alias = large.back();
+            small.pop_back();
+            m_bins[index].threshold = float(scaled[index]);
+            m_bins[index].alias     = alias;
+
+            scaled[alias] -= 1 - scaled[index];
+            if (scaled[alias] < 1) {
+                large.pop_back();
+                small.push_back(alias);
+            }
+        }
+
+        // the remaining bins are (up to rounding errors) exactly full
+        for (const auto &remaining : { small, large }) {
+            for (int index : remaining) {
+                m_bins[index].threshold = 1;
+                m_bins[index].alias     = index;
+            }
+        }
+    }
+
+    /// @brief Reports whether there is no index that can be sampled.
+    bool empty() const { return m_bins.empty(); }
+    /// @brief The number of indices in the table.
+    int size() const { return int(m_bins.size()); }
+
+    /// @brief Returns the probability of sampling the given index.
+    float probability(int index) const { return m_bins[index].probability; }
+
+    /**
+     * @brief Picks a random index, using the first coordinate of the sample
+     * to choose a bin and the second one to choose between the index of the
+     * bin and its alias.
+     * @note The table must not be empty.
+     */
+    int sample(const Point2 &sample) const {
+        const int index = std::min(int(sample.x() * size()), size() - 1);
+        const Bin &bin  = m_bins[index];
+        return sample.y() < bin.threshold ? index : bin.alias;
+    }
+};
+
 } // namespace lightwave
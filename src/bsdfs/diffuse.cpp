@@ -18,6 +18,7 @@ public:
         if (!Frame::sameHemisphere(wi, wo))
             return BsdfEval::invalid();
         bsdf.value = m_albedo->evaluate(uv) * InvPi * Frame::absCosTheta(wi.normalized());
+        bsdf.pdf = cosineHemispherePdf(wi.normalized());
         // bsdf.value = m_albedo->evaluate(uv);
         return bsdf;
     }
@@ -156,7 +156,10 @@ public:
             val = combination.metallic.sample(wo, rng);
             select_prob = 1.0f - combination.diffuseSelectionProb;         
         }
-        return { .wi = val.wi, .weight = val.weight / select_prob, .pdf = select_prob};  
+        // the pdf of the mixture of both lobes, as needed for MIS
+        const float pdf =
+            val.weight == Color(0.0f) ? 0.0f : evaluate(uv, wo, val.wi).pdf;
+        return { .wi = val.wi, .weight = val.weight / select_prob, .pdf = pdf};
 
 
         // hint: sample either `combination.diffuse` (probability
@@ -3,14 +3,15 @@
 
 namespace lightwave {
 
-CameraSample Camera::sample(const Point2i &pixel, Sampler &rng) const {
+CameraSample Camera::sample(const Point2i &pixel, const Vector2i &resolution,
+                            Sampler &rng) const {
     // begin by sampling a random position within the pixel
     const auto pixelPlusRandomOffset =
         Vector2(pixel.cast<float>()) + Vector2(rng.next2D());
     // normalize by image resolution to end up with value in range [-1,-1] to
     // [+1,+1]
     const auto normalized =
-        2 * pixelPlusRandomOffset / m_resolution.cast<float>() - Vector2(1);
+        2 * pixelPlusRandomOffset / resolution.cast<float>() - Vector2(1);
     // generate the sample using the normalized sample function
     const auto cameraSample = sample(normalized, rng);
     assert_normalized(cameraSample.ray.direction, {
@@ -5,6 +5,8 @@
 #include <stb_image.h>
 #include <tinyexr.h>
 
+#include <cstring>
+
 namespace lightwave {
 
 void Image::loadImage(const std::filesystem::path &path, bool isLinearSpace) {
@@ -74,6 +76,75 @@ void Image::saveAt(const std::filesystem::path &path) const {
         logger(EError, "  error saving image %s: %s", path, error);
     }
 }
+
+void Image::saveLayers(
+    const std::filesystem::path &path,
+    const std::vector<std::pair<std::string, const Image *>> &layers) {
+    if (layers.empty())
+        return;
+    const Point2i resolution = layers.front().second->resolution();
+    const int pixelCount     = resolution.x() * resolution.y();
+
+    struct Channel {
+        std::string name;
+        std::vector<float> values;
+    };
+    std::vector<Channel> channels;
+    for (const auto &[name, image] : layers) {
+        if (image->resolution() != resolution)
+            lightwave_throw("layer \"%s\" of %s has a different resolution",
+                            name,
+                            path);
+        for (int component = 0; component < Color::NumComponents;
+             component++) {
+            Channel channel{ std::string(name.empty() ? "" : name + ".") +
+                                 "RGB"[component],
+                             std::vector<float>(pixelCount) };
+            for (int i = 0; i < pixelCount; i++)
+                channel.values[i] = image->m_data[i][component];
+            channels.push_back(std::move(channel));
+        }
+    }
+    // readers expect the channels in alphabetical order
+    std::sort(channels.begin(), channels.end(), [](auto &a, auto &b) {
+        return a.name < b.name;
+    });
+
+    EXRHeader header;
+    InitEXRHeader(&header);
+    EXRImage image;
+    InitEXRImage(&image);
+
+    std::vector<EXRChannelInfo> channelInfos(channels.size());
+    std::vector<unsigned char *> channelData(channels.size());
+    // layers such as depth need more precision than half floats provide
+    std::vector<int> pixelTypes(channels.size(), TINYEXR_PIXELTYPE_FLOAT);
+    for (size_t i = 0; i < channels.size(); i++) {
+        strncpy(channelInfos[i].name, channels[i].name.c_str(), 255);
+        channelInfos[i].name[255] = '\0';
+        channelData[i] =
+            reinterpret_cast<unsigned char *>(channels[i].values.data());
+    }
+
+    image.images       = channelData.data();
+    image.num_channels = int(channels.size());
+    image.width        = resolution.x();
+    image.height       = resolution.y();
+
+    header.compression_type      = TINYEXR_COMPRESSIONTYPE_ZIP;
+    header.num_channels          = int(channels.size());
+    header.channels              = channelInfos.data();
+    header.pixel_types           = pixelTypes.data();
+    header.requested_pixel_types = pixelTypes.data();
+
+    logger(EInfo, "saving image %s", path);
+    const char *error;
+    if (SaveEXRImageToFile(
+            &image, &header, path.generic_string().c_str(), &error)) {
+        logger(EError, "  error saving image %s: %s", path, error);
+        FreeEXRErrorMessage(error);
+    }
+}
 } // namespace lightwave
 
 REGISTER_CLASS(Image, "image", "default")
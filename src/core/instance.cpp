@@ -91,10 +91,16 @@ inline void validateIntersection(const Intersection &its) {
 
 bool Instance::intersect(const Ray &worldRay, Intersection &its,
                          Sampler &rng) const {
+    // shapes only compute the density of sampling their hit points for area
+    // lights, as it can be costly (e.g., for solid angle sampling)
+    const bool neededPdf = its.needsPdf;
+    its.needsPdf         = neededPdf || m_light;
+
     if (!m_transform) {
         // fast path, if no transform is needed
         const Ray localRay        = worldRay;
         const bool wasIntersected = m_shape->intersect(localRay, its, rng);
+        its.needsPdf              = neededPdf;
         if (wasIntersected) {
             its.instance = this;
             validateIntersection(its);
@@ -105,7 +111,7 @@ bool Instance::intersect(const Ray &worldRay, Intersection &its,
     const float previousT = its.t;
     Ray localRay;
     // NOT_IMPLEMENTED
-    localRay = m_transform->inverse(worldRay);
+    localRay = toObject(worldRay);
     const float ray_length = localRay.direction.length();
     localRay = localRay.normalized();
     its.t = previousT * ray_length;
@@ -115,6 +121,7 @@ bool Instance::intersect(const Ray &worldRay, Intersection &its,
     // * how does its.t need to change?
 
     const bool wasIntersected = m_shape->intersect(localRay, its, rng);
+    its.needsPdf              = neededPdf;
     if (wasIntersected) {
         its.instance = this;
         validateIntersection(its);
@@ -129,29 +136,24 @@ bool Instance::intersect(const Ray &worldRay, Intersection &its,
     return wasIntersected;
 }
 
+bool Instance::occluded(const Ray &worldRay, float tMax, Sampler &rng) const {
+    if (!m_transform) {
+        // fast path, if no transform is needed
+        return m_shape->occluded(worldRay, tMax, rng);
+    }
+
+    const Ray localRay     = toObject(worldRay);
+    const float ray_length = localRay.direction.length();
+    return m_shape->occluded(localRay.normalized(), tMax * ray_length, rng);
+}
+
 Bounds Instance::getBoundingBox() const {
     if (!m_transform) {
         // fast path
         return m_shape->getBoundingBox();
     }
 
-    const Bounds untransformedAABB = m_shape->getBoundingBox();
-    if (untransformedAABB.isUnbounded()) {
-        return Bounds::full();
-    }
-
-    Bounds result;
-    for (int point = 0; point < 8; point++) {
-        Point p = untransformedAABB.min();
-        for (int dim = 0; dim < p.Dimension; dim++) {
-            if ((point >> dim) & 1) {
-                p[dim] = untransformedAABB.max()[dim];
-            }
-        }
-        p = m_transform->apply(p);
-        result.extend(p);
-    }
-    return result;
+    return m_shape->getTransformedBoundingBox(*m_transform);
 }
 
 Point Instance::getCentroid() const {
@@ -163,6 +165,21 @@ Point Instance::getCentroid() const {
     return m_transform->apply(m_shape->getCentroid());
 }
 
+DirectionCone Instance::getNormalCone() const {
+    // normal maps can tilt the normals arbitrarily
+    if (m_normal)
+        return DirectionCone::entireSphere();
+
+    const DirectionCone cone = m_shape->getNormalCone();
+    if (!m_transform || cone.cosTheta <= -1)
+        return cone;
+    // transforms that do not preserve angles widen cones in ways that are
+    // hard to bound, but single directions remain single directions
+    if (cone.cosTheta < 1)
+        return DirectionCone::entireSphere();
+    return { m_transform->applyNormal(cone.axis).normalized(), 1 };
+}
+
 AreaSample Instance::sampleArea(Sampler &rng) const {
     AreaSample sample = m_shape->sampleArea(rng);
     transformFrame(sample, Vector());
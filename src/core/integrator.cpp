@@ -1,47 +1,793 @@
+#include <lightwave/bsdf.hpp>
 #include <lightwave/camera.hpp>
+#include <lightwave/hash.hpp>
+#include <lightwave/instance.hpp>
 #include <lightwave/integrator.hpp>
 #include <lightwave/parallel.hpp>
 
 #include <algorithm>
+#include <atomic>
+#include <bit>
 #include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <fstream>
+#include <future>
+#include <limits>
+#include <memory>
 
 #include <lightwave/iterators.hpp>
 #include <lightwave/streaming.hpp>
 
+#include "partial.hpp"
+
 namespace lightwave {
 
+/// @brief The size of the blocks in which the image is rendered.
+static const Vector2i BlockSize{ 64 };
+/// @brief The size of the tiles that progressive rendering works on, which is
+/// also the granularity in which adaptive sampling decides where to sample.
+static const Vector2i TileSize{ 16 };
+
+bool resumeFromCheckpoints = false;
+RenderPartition renderPartition;
+RenderOverrides renderOverrides;
+
+/// @brief Set when the user (or a job scheduler) asks a progressive render to
+/// stop early.
+static std::atomic<bool> stopRequested = false;
+
+const std::array<const char *, AovCount> SamplingIntegrator::AovNames = {
+    "albedo", "normals", "distance", "instance", "bvh"
+};
+
+/// @brief The AOVs of the sample that the current thread renders, or null if
+/// no AOVs are needed.
+static thread_local std::array<Color, AovCount> *currentAovs = nullptr;
+/// @brief Whether the AOVs of the current sample have been recorded yet.
+static thread_local bool currentAovsRecorded = false;
+
+static void requestStop(int) {
+    stopRequested = true;
+    // pressing Ctrl+C a second time terminates as usual
+    std::signal(SIGINT, SIG_DFL);
+}
+
+float SamplingIntegrator::parseDuration(const std::string &value) {
+    size_t length  = 0;
+    float duration = 0;
+    try {
+        duration = std::stof(value, &length);
+    } catch (...) {
+        lightwave_throw("invalid duration \"%s\"", value);
+    }
+
+    const std::string unit = value.substr(length);
+    if (unit == "" || unit == "s")
+        return duration;
+    if (unit == "m")
+        return duration * 60;
+    if (unit == "h")
+        return duration * 3600;
+    lightwave_throw("invalid unit \"%s\" in duration \"%s\"", unit, value);
+}
+
+void SamplingIntegrator::recordAovs(const Intersection &its) const {
+    if (!currentAovs || currentAovsRecorded)
+        return;
+    currentAovsRecorded = true;
+
+    auto &aovs = *currentAovs;
+    if (its) {
+        const Bsdf *bsdf         = its.instance->bsdf();
+        aovs[int(Aov::Albedo)]   = bsdf ? bsdf->albedo(its.uv) : Color(0);
+        aovs[int(Aov::Normals)]  = Color(its.shadingNormal);
+        aovs[int(Aov::Distance)] = Color(its.t);
+        aovs[int(Aov::Instance)] = Color(float(its.instance->index()));
+    } else {
+        // misses are recorded as zero, as infinite distances would turn the
+        // mean of every pixel on a silhouette infinite as well
+        aovs[int(Aov::Albedo)]   = Color(0);
+        aovs[int(Aov::Normals)]  = Color(0);
+        aovs[int(Aov::Distance)] = Color(0);
+        aovs[int(Aov::Instance)] = Color(0);
+    }
+    aovs[int(Aov::Bvh)] =
+        Color(float(its.stats.bvhCounter), float(its.stats.primCounter), 0);
+}
+
+Color SamplingIntegrator::renderSamples(const View &view,
+                                        const Point2i &pixel, int firstSample,
+                                        int sampleCount, Sampler &rng,
+                                        float *squaredLuminance,
+                                        Color *aovSums) {
+    std::array<Color, AovCount> aovs;
+    currentAovs = aovSums ? &aovs : nullptr;
+
+    Color sum;
+    for (int sample = firstSample; sample < firstSample + sampleCount;
+         sample++) {
+        // samples are seeded by their pixel in the uncropped image, so that
+        // cropping does not change the result
+        const Point2i cameraPixel = pixel + Vector2i(view.crop.min());
+        rng.seed(cameraPixel, sample);
+        currentAovsRecorded = false;
+        auto cameraSample =
+            view.camera->sample(cameraPixel, view.resolution, rng);
+        const Color value = cameraSample.weight * Li(cameraSample.ray, rng);
+        sum += value;
+        if (squaredLuminance)
+            *squaredLuminance += sqr(value.luminance());
+
+        if (aovSums) {
+            // the integrator did not report its first hit
+            if (!currentAovsRecorded)
+                recordAovs(m_scene->intersect(cameraSample.ray, rng));
+            for (int aov = 0; aov < AovCount; aov++) {
+                if (isAveraged(Aov(aov)))
+                    aovSums[aov] += aovs[aov];
+                else if (sample == 0)
+                    aovSums[aov] = aovs[aov];
+            }
+        }
+    }
+    currentAovs = nullptr;
+    return sum;
+}
+
+void SamplingIntegrator::saveAovs(const View &view) const {
+    std::vector<std::pair<std::string, const Image *>> layers = {
+        { "", view.image.get() }
+    };
+    for (int aov = 0; aov < AovCount; aov++) {
+        if (!view.aovs[aov])
+            continue;
+        view.aovs[aov]->save();
+        layers.emplace_back(AovNames[aov], view.aovs[aov].get());
+    }
+    Image::saveLayers(view.image->defaultPath("_layers"), layers);
+}
+
+std::string RenderPartition::suffix() const {
+    std::string result;
+    if (blockCount > 1)
+        result += tfm::format("_tiles-%d-of-%d", blockIndex, blockCount);
+    if (firstSample > 0 || lastSample >= 0)
+        result += tfm::format("_samples-%d-%d", firstSample, lastSample);
+    if (!region.isEmpty()) {
+        result += tfm::format("_region-%d-%d-%d-%d",
+                              region.min().x(),
+                              region.min().y(),
+                              region.max().x(),
+                              region.max().y());
+    }
+    return result;
+}
+
+CropWindow CropWindow::parse(const std::string &value) {
+    CropWindow crop;
+    if (value.empty())
+        return crop;
+
+    Point2 min, max;
+    char trailing;
+    if (std::sscanf(value.c_str(),
+                    "%f,%f,%f,%f%c",
+                    &min.x(),
+                    &min.y(),
+                    &max.x(),
+                    &max.y(),
+                    &trailing) != 4)
+        lightwave_throw("invalid crop window \"%s\", expected x0,y0,x1,y1",
+                        value);
+    crop.bounds = Bounds2(min, max);
+    if (crop.isEmpty())
+        lightwave_throw("crop window \"%s\" is empty", value);
+    crop.isNormalized = value.find('.') != std::string::npos &&
+                        min.x() >= 0 && min.y() >= 0 && max.x() <= 1 &&
+                        max.y() <= 1;
+    return crop;
+}
+
+Bounds2i CropWindow::pixels(const Vector2i &resolution) const {
+    const Bounds2i image{ Point2i(0), Point2i(resolution) };
+    if (isEmpty())
+        return image;
+
+    Point2i min, max;
+    for (int dim = 0; dim < 2; dim++) {
+        const float scale = isNormalized ? float(resolution[dim]) : 1;
+        min[dim]          = int(std::round(bounds.min()[dim] * scale));
+        max[dim]          = int(std::round(bounds.max()[dim] * scale));
+    }
+    return image.clip(Bounds2i(min, max));
+}
+
+void SamplingIntegrator::renderBlocks() {
+    const int samplesPerPixel = this->samplesPerPixel();
+
+    // only render the blocks and samples of our partition of the image
+    const int firstSample =
+        std::min(renderPartition.firstSample, samplesPerPixel);
+    const int sampleCount =
+        (renderPartition.lastSample < 0
+             ? samplesPerPixel
+             : std::clamp(
+                   renderPartition.lastSample, firstSample, samplesPerPixel)) -
+        firstSample;
+    if (sampleCount <= 0)
+        lightwave_throw("the sample range starts at sample %d, but there "
+                        "are only %d samples per pixel",
+                        renderPartition.firstSample,
+                        samplesPerPixel);
+    const float norm = 1.0f / sampleCount;
+
+    std::vector<PartialRender> partials(m_views.size());
+    int pixelCount = 0;
+    for (size_t view = 0; view < m_views.size(); view++) {
+        const Vector2i resolution = m_views[view].size();
+        PartialRender &partial    = partials[view];
+        partial.resolution        = Point2i(resolution);
+        int blockIndex            = 0;
+        for (auto block : BlockSpiral(resolution, BlockSize)) {
+            if (blockIndex++ % renderPartition.blockCount !=
+                renderPartition.blockIndex)
+                continue;
+            if (!renderPartition.region.isEmpty())
+                block = renderPartition.region.clip(block);
+            if (!block.isEmpty()) {
+                partial.blocks.push_back(
+                    { block, firstSample, sampleCount, {} });
+                pixelCount += block.diagonal().product();
+            }
+        }
+    }
+
+    // the blocks of all views share one parallel loop
+    std::vector<std::pair<int, PartialRender::Block *>> jobs;
+    for (size_t view = 0; view < m_views.size(); view++) {
+        for (auto &block : partials[view].blocks)
+            jobs.emplace_back(int(view), &block);
+    }
+
+    // partial renders only contain the rendered image
+    const bool renderAovs = hasAovs() && !renderPartition.isPartial();
+
+    std::vector<std::unique_ptr<Streaming>> streams;
+    for (const auto &view : m_views)
+        streams.push_back(
+            std::make_unique<Streaming>(*view.image, streams.empty()));
+    ProgressReporter progress{ pixelCount };
+    for_each_parallel(jobs, [&](const auto &job) {
+        const View &view             = m_views[job.first];
+        PartialRender::Block &block = *job.second;
+        auto sampler                = m_sampler->clone();
+        block.sums.reserve(block.bounds.diagonal().product());
+        for (auto pixel : block.bounds) {
+            std::array<Color, AovCount> aovSums;
+            const Color sum = renderSamples(view,
+                                            pixel,
+                                            firstSample,
+                                            sampleCount,
+                                            *sampler,
+                                            nullptr,
+                                            renderAovs ? aovSums.data()
+                                                       : nullptr);
+            view.image->get(pixel) = norm * sum;
+            if (renderPartition.isPartial())
+                block.sums.push_back(sum);
+            for (int aov = 0; renderAovs && aov < AovCount; aov++) {
+                if (view.aovs[aov])
+                    view.aovs[aov]->get(pixel) =
+                        isAveraged(Aov(aov)) ? norm * aovSums[aov]
+                                             : aovSums[aov];
+            }
+        }
+
+        progress += block.bounds.diagonal().product();
+        streams[job.first]->updateBlock(block.bounds);
+    });
+    progress.finish();
+
+    if (renderPartition.isPartial()) {
+        for (size_t view = 0; view < m_views.size(); view++) {
+            partials[view].save(
+                m_views[view]
+                    .image->defaultPath(renderPartition.suffix())
+                    .replace_extension(".partial"));
+        }
+    }
+}
+
+namespace {
+
+/**
+ * @brief Everything that progressive rendering needs to continue where it
+ * left off, which is stored in checkpoint files.
+ * Since samples are seeded by their index, a render that is continued from a
+ * checkpoint produces exactly the same image as an uninterrupted one.
+ */
+struct ProgressiveState {
+    /// @brief The number of passes that have been rendered.
+    int passes = 0;
+    /// @brief The total number of samples over all pixels.
+    int64_t samplesSpent = 0;
+    /// @brief The number of samples per pixel of each tile.
+    std::vector<int> tileSamples;
+    /// @brief Whether each tile needs further samples.
+    std::vector<uint8_t> tileActive;
+    /// @brief The sum of all samples of each pixel.
+    std::vector<Color> sums;
+    /// @brief The sum of all squared sample luminances of each pixel (only
+    /// used for adaptive sampling).
+    std::vector<float> squaredLuminances;
+    /// @brief The sums of all AOVs of each pixel (only used if AOVs are
+    /// written).
+    std::vector<Color> aovSums;
+
+    /// @brief Identifies checkpoint files and their version.
+    static constexpr uint32_t Magic = 0x4b43574c; // "LWCK"
+    static constexpr uint32_t Version = 2;
+
+    /**
+     * @brief Writes the state to a file, which is replaced atomically (by
+     * writing to a temporary file first), so that the previous checkpoint
+     * survives if the process is killed while writing.
+     * @note The data is stored in the native byte order.
+     */
+    void save(const std::filesystem::path &path, uint64_t settings) const {
+        auto temporaryPath = path;
+        temporaryPath += ".tmp";
+        {
+            std::ofstream file{ temporaryPath, std::ios::binary };
+            write(file, Magic);
+            write(file, Version);
+            write(file, settings);
+            write(file, passes);
+            write(file, samplesSpent);
+            write(file, tileSamples);
+            write(file, tileActive);
+            write(file, sums);
+            write(file, squaredLuminances);
+            write(file, aovSums);
+            if (!file) {
+                logger(EError, "could not write checkpoint %s", temporaryPath);
+                return;
+            }
+        }
+        std::filesystem::rename(temporaryPath, path);
+    }
+
+    /**
+     * @brief Reads the state from a file, which needs to have been written for
+     * the same settings (and hence the same number of tiles and pixels).
+     */
+    void load(const std::filesystem::path &path, uint64_t settings) {
+        std::ifstream file{ path, std::ios::binary };
+        if (!file)
+            lightwave_throw("could not open checkpoint %s", path);
+        if (read<uint32_t>(file) != Magic || read<uint32_t>(file) != Version)
+            lightwave_throw("%s is not a valid checkpoint", path);
+        if (read<uint64_t>(file) != settings)
+            lightwave_throw("checkpoint %s was written for different render "
+                            "settings",
+                            path);
+
+        passes       = read<int>(file);
+        samplesSpent = read<int64_t>(file);
+        read(file, tileSamples);
+        read(file, tileActive);
+        read(file, sums);
+        read(file, squaredLuminances);
+        read(file, aovSums);
+        if (!file)
+            lightwave_throw("checkpoint %s is truncated", path);
+    }
+
+private:
+    template <typename T> static void write(std::ostream &os, const T &value) {
+        os.write(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+    template <typename T>
+    static void write(std::ostream &os, const std::vector<T> &values) {
+        os.write(reinterpret_cast<const char *>(values.data()),
+                 values.size() * sizeof(T));
+    }
+    template <typename T> static T read(std::istream &is) {
+        T value{};
+        is.read(reinterpret_cast<char *>(&value), sizeof(T));
+        return value;
+    }
+    template <typename T>
+    static void read(std::istream &is, std::vector<T> &values) {
+        // the sizes are already known from the settings
+        is.read(reinterpret_cast<char *>(values.data()),
+                values.size() * sizeof(T));
+    }
+};
+
+} // namespace
+
+std::filesystem::path
+SamplingIntegrator::checkpointPath(const View &view) const {
+    return view.image->defaultPath().replace_extension(".checkpoint");
+}
+
+bool SamplingIntegrator::renderProgressive(const View &view) {
+    const Vector2i resolution = view.size();
+    const int samplesPerPixel = this->samplesPerPixel();
+    const bool hasDeadline    = m_timeBudget > 0;
+    // with a time budget, the sample count is only limited by the deadline
+    const int maxSamples = m_adaptive   ? m_maxSamples
+                           : hasDeadline ? std::numeric_limits<int>::max()
+                                         : samplesPerPixel;
+    const int minSamples = std::min(m_minSamples, samplesPerPixel);
+
+    std::vector<Bounds2i> tiles;
+    for (auto bounds : BlockSpiral(resolution, TileSize))
+        tiles.push_back(bounds);
+
+    // the image always holds the mean of the sums of all samples
+    ProgressiveState state;
+    state.tileSamples.resize(tiles.size(), 0);
+    state.tileActive.resize(tiles.size(), true);
+    state.sums.resize(resolution.product());
+    state.squaredLuminances.resize(m_adaptive ? state.sums.size() : 0);
+    state.aovSums.resize(hasAovs() ? state.sums.size() * AovCount : 0);
+    auto index = [&](const Point2i &pixel) {
+        return pixel.y() * resolution.x() + pixel.x();
+    };
+    // writes the mean of the AOV sums of a pixel to the AOV images
+    auto updateAovs = [&](const Point2i &pixel, int totalSamples) {
+        for (int aov = 0; aov < AovCount; aov++) {
+            if (!view.aovs[aov])
+                continue;
+            const Color &sum = state.aovSums[index(pixel) * AovCount + aov];
+            view.aovs[aov]->get(pixel) =
+                isAveraged(Aov(aov)) ? sum / float(totalSamples) : sum;
+        }
+    };
+
+    // checkpoints can only be continued with the same settings, integrator,
+    // sampler and scene (whose fingerprints cover their definition in the
+    // scene file)
+    const uint64_t settings = hash::fnv1a(m_attributeFingerprint,
+                                          m_scene->fingerprint(),
+                                          m_sampler->fingerprint(),
+                                          view.resolution.x(),
+                                          view.resolution.y(),
+                                          view.crop.min().x(),
+                                          view.crop.min().y(),
+                                          resolution.x(),
+                                          resolution.y(),
+                                          samplesPerPixel,
+                                          m_samplesPerPass,
+                                          m_adaptive,
+                                          std::bit_cast<uint32_t>(m_threshold),
+                                          minSamples,
+                                          maxSamples,
+                                          hasAovs());
+    if (resumeFromCheckpoints && m_checkpointInterval > 0) {
+        if (std::filesystem::exists(checkpointPath(view))) {
+            state.load(checkpointPath(view), settings);
+            for (size_t tile = 0; tile < tiles.size(); tile++) {
+                for (auto pixel : tiles[tile]) {
+                    const int i = index(pixel);
+                    if (state.tileSamples[tile] > 0) {
+                        view.image->get(pixel) =
+                            state.sums[i] / float(state.tileSamples[tile]);
+                        updateAovs(pixel, state.tileSamples[tile]);
+                    }
+                }
+            }
+            logger(EInfo,
+                   "resuming from checkpoint %s after %d passes",
+                   checkpointPath(view),
+                   state.passes);
+        } else {
+            logger(EWarn,
+                   "no checkpoint found at %s, starting from scratch",
+                   checkpointPath(view));
+        }
+    }
+
+    // adaptive sampling stops once the samples that a uniform render would
+    // have taken are spent (unless there is a time budget instead)
+    const int64_t budget =
+        hasDeadline ? std::numeric_limits<int64_t>::max()
+                    : int64_t(samplesPerPixel) * resolution.product();
+    std::atomic<int64_t> samplesSpent = state.samplesSpent;
+
+    // checkpoints are written in the background from a copy of the state,
+    // which only briefly interrupts rendering between passes
+    std::future<void> pendingCheckpoint;
+    Timer checkpointTimer;
+    auto checkpoint = [&]() {
+        if (pendingCheckpoint.valid())
+            pendingCheckpoint.get();
+        state.samplesSpent = samplesSpent;
+        pendingCheckpoint  = std::async(
+            std::launch::async,
+            [path = checkpointPath(view), snapshot = state, settings]() {
+                snapshot.save(path, settings);
+            });
+        checkpointTimer = Timer();
+    };
+
+    Streaming stream{ *view.image };
+    stream.startRegularUpdates();
+
+    stopRequested = false;
+    const auto previousInterruptHandler = std::signal(SIGINT, requestStop);
+    const auto previousTerminateHandler = std::signal(SIGTERM, requestStop);
+
+    ProgressReporter progress{ int(tiles.size()) *
+                               (hasDeadline
+                                    ? 1
+                                    : (samplesPerPixel + m_samplesPerPass - 1) /
+                                          m_samplesPerPass) };
+    progress.update(int(tiles.size()) * state.passes);
+    const Timer timer;
+    float lastPassTime = 0;
+    std::vector<int> activeTiles;
+    for (int pass = 0; !stopRequested && samplesSpent < budget; pass++) {
+        const float passStart = timer.getElapsedTime();
+        if (hasDeadline && pass > 0 &&
+            passStart + lastPassTime > m_timeBudget) {
+            // the next pass would likely not finish in time
+            break;
+        }
+
+        activeTiles.clear();
+        for (size_t tile = 0; tile < tiles.size(); tile++) {
+            if (state.tileActive[tile])
+                activeTiles.push_back(int(tile));
+        }
+        if (activeTiles.empty())
+            break;
+
+        for_each_parallel(activeTiles, [&](int tile) {
+            // each tile is only ever accessed by one thread at a time
+            auto sampler         = m_sampler->clone();
+            int &tileSamples     = state.tileSamples[tile];
+            const int sampleCount =
+                std::min(m_samplesPerPass, maxSamples - tileSamples);
+            const int totalSamples = tileSamples + sampleCount;
+
+            float error = 0;
+            for (auto pixel : tiles[tile]) {
+                const int i = index(pixel);
+                state.sums[i] +=
+                    renderSamples(view,
+                                  pixel,
+                                  tileSamples,
+                                  sampleCount,
+                                  *sampler,
+                                  m_adaptive ? &state.squaredLuminances[i]
+                                             : nullptr,
+                                  hasAovs() ? &state.aovSums[i * AovCount]
+                                            : nullptr);
+                view.image->get(pixel) = state.sums[i] / float(totalSamples);
+                updateAovs(pixel, totalSamples);
+
+                if (m_adaptive && totalSamples > 1) {
+                    // relative standard error of the mean luminance (with a
+                    // lower bound for the mean, to not waste samples on
+                    // almost black pixels)
+                    const float mean =
+                        state.sums[i].luminance() / totalSamples;
+                    const float variance =
+                        std::max(0.f,
+                                 state.squaredLuminances[i] / totalSamples -
+                                     sqr(mean)) *
+                        totalSamples / (totalSamples - 1);
+                    error += std::sqrt(variance / totalSamples) /
+                             std::max(mean, 1e-2f);
+                }
+            }
+
+            const int pixelCount = tiles[tile].diagonal().product();
+            tileSamples          = totalSamples;
+            if (tileSamples >= maxSamples) {
+                state.tileActive[tile] = false;
+            } else if (m_adaptive && tileSamples >= minSamples &&
+                       error / pixelCount < m_threshold) {
+                state.tileActive[tile] = false;
+            }
+            samplesSpent += int64_t(sampleCount) * pixelCount;
+            progress += 1;
+        });
+        state.passes++;
+
+        lastPassTime = timer.getElapsedTime() - passStart;
+        if (hasDeadline && pass == 0) {
+            // the first pass serves as pilot to measure the throughput
+            const int expectedPasses =
+                std::max(1, int(m_timeBudget / std::max(lastPassTime, 1e-3f)));
+            logger(EInfo,
+                   "pilot pass took %.2f seconds, expecting %d passes of %d "
+                   "samples per pixel",
+                   lastPassTime,
+                   expectedPasses,
+                   m_samplesPerPass);
+            progress.update(0, int(tiles.size()) * (expectedPasses - 1));
+        }
+
+        if (m_checkpointInterval > 0 &&
+            checkpointTimer.getElapsedTime() >= m_checkpointInterval)
+            checkpoint();
+    }
+
+    std::signal(SIGINT, previousInterruptHandler);
+    std::signal(SIGTERM, previousTerminateHandler);
+    stream.stopRegularUpdates();
+    progress.finish();
+
+    const float averageSamples = float(samplesSpent) / resolution.product();
+    if (stopRequested) {
+        logger(EWarn,
+               "render stopped after %.1f of %d samples per pixel",
+               averageSamples,
+               samplesPerPixel);
+        // allows to continue the render later on
+        if (m_checkpointInterval > 0)
+            checkpoint();
+    } else if (m_adaptive || hasDeadline) {
+        logger(EInfo,
+               "rendered %.1f samples per pixel on average in %.1f seconds",
+               averageSamples,
+               timer.getElapsedTime());
+    }
+    if (pendingCheckpoint.valid())
+        pendingCheckpoint.get();
+    stream.update();
+
+    if (m_adaptive) {
+        // allows to check where samples were spent
+        Image sampleCounts{ resolution };
+        for (size_t tile = 0; tile < tiles.size(); tile++) {
+            for (auto pixel : tiles[tile])
+                sampleCounts(pixel) = Color(float(state.tileSamples[tile]));
+        }
+        sampleCounts.saveAt(view.image->defaultPath("_samples"));
+    }
+    return !stopRequested;
+}
+
+/// @brief Creates an image that is stored next to another image, with a
+/// suffix appended to its name.
+static ref<Image> siblingImage(const Image &image, const std::string &suffix) {
+    auto sibling = std::make_shared<Image>();
+    sibling->setBasePath(image.defaultPath().parent_path());
+    sibling->setId(image.id() + suffix);
+    return sibling;
+}
+
 void SamplingIntegrator::execute() {
     if (!m_image) {
         lightwave_throw(
             "<integrator /> needs an <image /> child to render into!");
     }
 
-    const Vector2i resolution = m_scene->camera()->resolution();
-    m_image->initialize(resolution);
+    std::vector<const Camera *> cameras;
+    for (const auto &camera : m_scene->cameras()) {
+        if (renderOverrides.camera.empty() ||
+            camera->id() == renderOverrides.camera)
+            cameras.push_back(camera.get());
+    }
+    if (cameras.empty()) {
+        lightwave_throw("the scene has no camera with id \"%s\"",
+                        renderOverrides.camera);
+    }
 
-    const float norm = 1.0f / m_sampler->samplesPerPixel();
+    ref<Image> image = m_image;
+    if (!renderOverrides.output.empty()) {
+        // the image of the integrator receives a copy of the result after
+        // rendering (e.g., for postprocessing), but is not saved
+        const auto &output = renderOverrides.output;
+        image              = std::make_shared<Image>();
+        image->setBasePath(output.parent_path());
+        image->setId(output.stem().string());
+    }
 
-    Streaming stream{ *m_image };
-    ProgressReporter progress{ resolution.product() };
-    for_each_parallel(BlockSpiral(resolution, Vector2i(64)), [&](auto block) {
-        auto sampler = m_sampler->clone();
-        for (auto pixel : block) {
-            Color sum;
-            for (int sample = 0; sample < m_sampler->samplesPerPixel();
-                 sample++) {
-                sampler->seed(pixel, sample);
-                auto cameraSample = m_scene->camera()->sample(pixel, *sampler);
-                sum += cameraSample.weight * Li(cameraSample.ray, *sampler);
+    const CropWindow &crop =
+        renderOverrides.crop.isEmpty() ? m_crop : renderOverrides.crop;
+
+    // all cameras share the loaded scene, only their images differ
+    m_views.clear();
+    for (size_t i = 0; i < cameras.size(); i++) {
+        const Vector2i resolution = renderOverrides.resolution.isZero()
+                                        ? cameras[i]->resolution()
+                                        : renderOverrides.resolution;
+        View view{
+            cameras[i], resolution, crop.pixels(resolution), image, m_aovs
+        };
+        if (view.crop.isEmpty()) {
+            lightwave_throw("the crop window does not overlap the image of "
+                            "resolution %dx%d",
+                            resolution.x(),
+                            resolution.y());
+        }
+        if (i > 0) {
+            const std::string suffix =
+                "_" + (cameras[i]->id().empty() ? tfm::format("view%d", i)
+                                                : cameras[i]->id());
+            view.image = siblingImage(*image, suffix);
+            for (auto &aov : view.aovs) {
+                if (aov)
+                    aov = siblingImage(*aov, suffix);
             }
-            m_image->get(pixel) = norm * sum;
         }
 
-        progress += block.diagonal().product();
-        stream.updateBlock(block);
-    });
-    progress.finish();
+        const Point2i size{ view.size() };
+        view.image->initialize(size);
+        for (const auto &aov : view.aovs) {
+            if (aov)
+                aov->initialize(size);
+        }
+        if (!crop.isEmpty()) {
+            logger(EInfo,
+                   "rendering pixels [%d,%d) x [%d,%d) of the %dx%d image",
+                   view.crop.min().x(),
+                   view.crop.max().x(),
+                   view.crop.min().y(),
+                   view.crop.max().y(),
+                   resolution.x(),
+                   resolution.y());
+        }
+        m_views.push_back(view);
+    }
+    if (m_views.size() > 1)
+        logger(EInfo, "rendering %d views of the scene", m_views.size());
+    if (resumeFromCheckpoints && m_checkpointInterval == 0) {
+        logger(EWarn,
+               "--resume has no effect without a checkpoint interval, "
+               "rendering from scratch");
+    }
 
-    m_image->save();
+    const bool isProgressive = m_progressive || m_adaptive ||
+                               m_timeBudget > 0 || m_checkpointInterval > 0;
+    if (renderPartition.isPartial()) {
+        if (isProgressive) {
+            logger(EWarn,
+                   "partial renders do not support progressive rendering, "
+                   "rendering block by block instead");
+        }
+        if (hasAovs()) {
+            logger(EWarn,
+                   "partial renders do not support AOVs, only rendering the "
+                   "image");
+        }
+        // the image of this process is only a part of the final image, which
+        // is created by merging all partial renders
+        renderBlocks();
+        return;
+    }
+
+    auto save = [&](const View &view, bool isComplete) {
+        view.image->save();
+        if (view.image != m_image && view.image == image)
+            m_image->copy(*view.image);
+        if (hasAovs())
+            saveAovs(view);
+        if (isComplete && m_checkpointInterval > 0)
+            std::filesystem::remove(checkpointPath(view));
+    };
+
+    if (isProgressive) {
+        // each view has its own passes (and checkpoint), a stopped render
+        // does not continue with the remaining views
+        for (const auto &view : m_views) {
+            const bool isComplete = renderProgressive(view);
+            save(view, isComplete);
+            if (!isComplete)
+                break;
+        }
+    } else {
+        renderBlocks();
+        for (const auto &view : m_views)
+            save(view, true);
+    }
 }
 
 } // namespace lightwave
@@ -0,0 +1,338 @@
+#include <lightwave/properties.hpp>
+
+#include "lightbvh.hpp"
+
+#include <array>
+
+namespace lightwave {
+
+namespace {
+
+/// @brief The largest float below one.
+constexpr float OneMinusEpsilon = 0x1.fffffep-1f;
+
+/// @brief Returns cos(max(0, a - b)) given the sines and cosines of a and b.
+float cosSubClamped(float sinA, float cosA, float sinB, float cosB) {
+    if (cosA > cosB)
+        return 1;
+    return cosA * cosB + sinA * sinB;
+}
+
+/// @brief Returns sin(max(0, a - b)) given the sines and cosines of a and b.
+float sinSubClamped(float sinA, float cosA, float sinB, float cosB) {
+    if (cosA > cosB)
+        return 0;
+    return sinA * cosB - cosA * sinB;
+}
+
+/**
+ * @brief Estimates how costly it is to sample the lights within given bounds
+ * as one subtree, which grows with their power, their spatial extent and how
+ * many directions they emit light in (the surface area orientation heuristic
+ * of Conty Estevez and Kulla).
+ * @param dimension The axis along which the lights are being split, which
+ * penalizes splits of thin bounds along their longest axis.
+ */
+float splitCost(const LightBounds &lights, const Bounds &parent,
+                int dimension) {
+    const float thetaO = safe_acos(lights.normals.cosTheta);
+    const float thetaE = safe_acos(lights.cosThetaEmission);
+    const float thetaW = std::min(thetaO + thetaE, Pi);
+    const float sinO   = safe_sqrt(1 - sqr(lights.normals.cosTheta));
+    const float solidAngle =
+        2 * Pi * (1 - lights.normals.cosTheta) +
+        Pi / 2 *
+            (2 * thetaW * sinO - std::cos(thetaO - 2 * thetaW) -
+             2 * thetaO * sinO + lights.normals.cosTheta);
+
+    const Vector parentExtent = parent.diagonal();
+    const float aspect        = parentExtent[dimension] > 0
+                                    ? parentExtent.maxComponent() /
+                                   parentExtent[dimension]
+                                    : 1;
+
+    const Vector extent = lights.bounds.diagonal();
+    const float surfaceArea =
+        2 * (extent.x() * extent.y() + extent.x() * extent.z() +
+             extent.y() * extent.z());
+    return lights.power * solidAngle * aspect * surfaceArea;
+}
+
+} // namespace
+
+LightBVH::LightBVH(const std::vector<ref<Light>> &lights) {
+    for (const auto &light : lights) {
+        if (light->index() < 0)
+            lightwave_throw("lights need an index to be part of a hierarchy");
+        m_entries.resize(std::max(int(m_entries.size()), light->index() + 1));
+        m_entries[light->index()].light = light.get();
+    }
+
+    std::vector<std::pair<int, LightBounds>> boundedLights;
+    for (const auto &light : lights) {
+        const float weight = light->samplingWeight();
+        if (weight == 0)
+            continue;
+
+        const auto bounds = light->bounds();
+        if (!bounds) {
+            m_infiniteLights.emplace_back(light.get(), weight);
+            m_infiniteWeight += weight;
+            continue;
+        }
+        if (!(bounds->power > 0))
+            continue;
+        boundedLights.emplace_back(int(m_boundedLights.size()), *bounds);
+        m_boundedLights.push_back(light.get());
+        m_entries[light->index()].isBounded = true;
+    }
+
+    if (!boundedLights.empty()) {
+        m_nodes.reserve(2 * boundedLights.size() - 1);
+        build(boundedLights, 0, int(boundedLights.size()), 0, 0);
+    }
+
+    // the hierarchy is picked like a single light with a weight of one
+    if (m_infiniteWeight > 0) {
+        m_infiniteProbability =
+            m_infiniteWeight / (m_infiniteWeight + (m_nodes.empty() ? 0 : 1));
+        for (const auto &[light, weight] : m_infiniteLights) {
+            m_entries[light->index()].probability =
+                m_infiniteProbability * weight / m_infiniteWeight;
+        }
+    }
+}
+
+int LightBVH::build(std::vector<std::pair<int, LightBounds>> &lights,
+                    int begin, int end, uint64_t bitTrail, int depth) {
+    if (end - begin == 1) {
+        const int nodeIndex = int(m_nodes.size());
+        m_nodes.push_back({
+            .bounds       = lights[begin].second,
+            .childOrLight = lights[begin].first,
+            .isLeaf       = true,
+        });
+        m_entries[m_boundedLights[lights[begin].first]->index()].bitTrail =
+            bitTrail;
+        return nodeIndex;
+    }
+
+    Bounds bounds, centroidBounds;
+    for (int i = begin; i < end; i++) {
+        bounds.extend(lights[i].second.bounds);
+        centroidBounds.extend(lights[i].second.bounds.center());
+    }
+
+    // find the cheapest split into buckets along any axis
+    constexpr int BucketCount = 12;
+    float minCost             = Infinity;
+    int minBucket = -1, minDimension = -1;
+    for (int dimension = 0; dimension < 3; dimension++) {
+        const float lower = centroidBounds.min()[dimension];
+        const float upper = centroidBounds.max()[dimension];
+        if (!(upper > lower))
+            continue;
+
+        auto bucketOf = [&](const LightBounds &light) {
+            const float relative =
+                (light.bounds.center()[dimension] - lower) / (upper - lower);
+            return clamp(int(relative * BucketCount), 0, BucketCount - 1);
+        };
+
+        std::array<LightBounds, BucketCount> buckets;
+        buckets.fill(LightBounds{});
+        for (int i = begin; i < end; i++) {
+            auto &bucket = buckets[bucketOf(lights[i].second)];
+            bucket       = LightBounds::merge(bucket, lights[i].second);
+        }
+
+        for (int split = 0; split < BucketCount - 1; split++) {
+            LightBounds below{}, above{};
+            for (int i = 0; i <= split; i++)
+                below = LightBounds::merge(below, buckets[i]);
+            for (int i = split + 1; i < BucketCount; i++)
+                above = LightBounds::merge(above, buckets[i]);
+            if (below.power == 0 || above.power == 0)
+                continue;
+
+            const float cost = splitCost(below, bounds, dimension) +
+                               splitCost(above, bounds, dimension);
+            if (cost < minCost) {
+                minCost      = cost;
+                minBucket    = split;
+                minDimension = dimension;
+            }
+        }
+    }
+
+    int middle;
+    if (minBucket >= 0 && depth < 32) {
+        const float lower = centroidBounds.min()[minDimension];
+        const float upper = centroidBounds.max()[minDimension];
+        const auto split  = std::partition(
+            lights.begin() + begin,
+            lights.begin() + end,
+            [&](const std::pair<int, LightBounds> &light) {
+                const float relative =
+                    (light.second.bounds.center()[minDimension] - lower) /
+                    (upper - lower);
+                return clamp(int(relative * BucketCount), 0, BucketCount - 1) <=
+                       minBucket;
+            });
+        middle = int(split - lights.begin());
+    } else {
+        // all lights are at the same position (or the tree is getting too
+        // deep), so they are split evenly
+        middle = (begin + end) / 2;
+    }
+    if (middle == begin || middle == end)
+        middle = (begin + end) / 2;
+
+    const int nodeIndex = int(m_nodes.size());
+    m_nodes.push_back(Node{});
+    build(lights, begin, middle, bitTrail, depth + 1);
+    const int secondChild =
+        build(lights, middle, end, bitTrail | (uint64_t(1) << depth), depth + 1);
+
+    Node &node        = m_nodes[nodeIndex];
+    node.childOrLight = secondChild;
+    node.bounds       = LightBounds::merge(m_nodes[nodeIndex + 1].bounds,
+                                     m_nodes[secondChild].bounds);
+    return nodeIndex;
+}
+
+float LightBVH::importance(const LightBounds &bounds, const Point &position,
+                           const Vector &normal) {
+    if (bounds.power == 0)
+        return 0;
+
+    // the distance is clamped, so that points within the bounds do not
+    // receive arbitrarily large importance
+    const Point center = bounds.bounds.center();
+    const float radius = bounds.bounds.diagonal().length() / 2;
+    const Vector toPoint     = position - center;
+    const float distanceSqr  = std::max(toPoint.lengthSquared(), radius);
+    const float distance     = toPoint.length();
+    const Vector wi = distance > 0 ? toPoint / distance : Vector(0, 0, 1);
+
+    // the angle between the axis of the normals and the point
+    const float cosW = bounds.normals.axis.dot(wi);
+    const float sinW = safe_sqrt(1 - sqr(cosW));
+
+    // the half-angle under which the bounds are seen from the point
+    float cosB = -1;
+    if (distance > radius)
+        cosB = safe_sqrt(1 - sqr(radius / distance));
+    const float sinB = safe_sqrt(1 - sqr(cosB));
+
+    // the smallest angle between a normal within the cone and a direction
+    // towards the point
+    const float cosO = bounds.normals.cosTheta;
+    const float sinO = safe_sqrt(1 - sqr(cosO));
+    const float cosX = cosSubClamped(sinW, cosW, sinO, cosO);
+    const float sinX = sinSubClamped(sinW, cosW, sinO, cosO);
+    const float cosP = cosSubClamped(sinX, cosX, sinB, cosB);
+    if (cosP <= bounds.cosThetaEmission)
+        return 0;
+
+    float importance = bounds.power * cosP / distanceSqr;
+
+    // the smallest angle between the normal of the point and a direction
+    // towards the bounds
+    if (normal != Vector(0)) {
+        const float cosI = abs(normal.dot(wi));
+        const float sinI = safe_sqrt(1 - sqr(cosI));
+        importance *= cosSubClamped(sinI, cosI, sinB, cosB);
+    }
+    return std::max(importance, 0.f);
+}
+
+LightSample LightBVH::sample(const Point &position, const Vector &normal,
+                             float u) const {
+    if (u < m_infiniteProbability) {
+        // pick a light without bounds proportionally to its weight
+        float target = u / m_infiniteProbability * m_infiniteWeight;
+        for (const auto &[light, weight] : m_infiniteLights) {
+            if (target < weight || light == m_infiniteLights.back().first) {
+                return {
+                    .light       = light,
+                    .probability = m_infiniteProbability * weight /
+                                   m_infiniteWeight,
+                };
+            }
+            target -= weight;
+        }
+    }
+    if (m_nodes.empty())
+        return LightSample::invalid();
+
+    u = std::min((u - m_infiniteProbability) / (1 - m_infiniteProbability),
+                 OneMinusEpsilon);
+    float probability = 1 - m_infiniteProbability;
+    int nodeIndex     = 0;
+    while (!m_nodes[nodeIndex].isLeaf) {
+        const int children[2]    = { nodeIndex + 1,
+                                     m_nodes[nodeIndex].childOrLight };
+        const float importances[2] = {
+            importance(m_nodes[children[0]].bounds, position, normal),
+            importance(m_nodes[children[1]].bounds, position, normal),
+        };
+        const float total = importances[0] + importances[1];
+        if (total == 0)
+            return LightSample::invalid();
+
+        // the random number is reused for the next decision
+        const float firstProbability = importances[0] / total;
+        if (u < firstProbability) {
+            nodeIndex = children[0];
+            u         = std::min(u / firstProbability, OneMinusEpsilon);
+            probability *= firstProbability;
+        } else {
+            nodeIndex = children[1];
+            u = std::min((u - firstProbability) / (1 - firstProbability),
+                         OneMinusEpsilon);
+            probability *= 1 - firstProbability;
+        }
+    }
+
+    // a single light in the hierarchy is only picked if it can contribute
+    if (nodeIndex == 0 && importance(m_nodes[0].bounds, position, normal) == 0)
+        return LightSample::invalid();
+    return {
+        .light       = m_boundedLights[m_nodes[nodeIndex].childOrLight],
+        .probability = probability,
+    };
+}
+
+float LightBVH::probability(const Light *light, const Point &position,
+                            const Vector &normal) const {
+    const Entry *lightEntry = entry(light);
+    if (!lightEntry)
+        return 0;
+    if (!lightEntry->isBounded)
+        return lightEntry->probability;
+
+    uint64_t bitTrail = lightEntry->bitTrail;
+    float probability = 1 - m_infiniteProbability;
+    int nodeIndex     = 0;
+    while (!m_nodes[nodeIndex].isLeaf) {
+        const int children[2]    = { nodeIndex + 1,
+                                     m_nodes[nodeIndex].childOrLight };
+        const float importances[2] = {
+            importance(m_nodes[children[0]].bounds, position, normal),
+            importance(m_nodes[children[1]].bounds, position, normal),
+        };
+        const int child = int(bitTrail & 1);
+        if (importances[child] == 0)
+            return 0;
+        probability *= importances[child] / (importances[0] + importances[1]);
+        nodeIndex = children[child];
+        bitTrail >>= 1;
+    }
+
+    if (nodeIndex == 0 && importance(m_nodes[0].bounds, position, normal) == 0)
+        return 0;
+    return probability;
+}
+
+} // namespace lightwave
@@ -0,0 +1,110 @@
+/**
+ * @brief A hierarchy over light sources to pick lights that are likely to
+ * contribute much to a point.
+ * @file lightbvh.hpp
+ */
+
+#pragma once
+
+#include <lightwave/light.hpp>
+#include <lightwave/scene.hpp>
+
+#include <vector>
+
+namespace lightwave {
+
+/**
+ * @brief Picks lights randomly, with probabilities that depend on the point
+ * they illuminate. Lights are organized in a bounding volume hierarchy, whose
+ * nodes bound the position, orientation and power of the lights below them.
+ * Starting at the root, a child is chosen with probability proportional to an
+ * estimate of how much light it contributes to the point, so that lights that
+ * are far away or face away from the point are rarely (or never) picked. This
+ * follows the light BVH of pbrt-v4, which builds on Conty Estevez and Kulla,
+ * "Importance Sampling of Many Lights with Adaptive Tree Splitting" (2018).
+ *
+ * Lights without bounds (see @ref Light::bounds) are picked independently of
+ * the point, and lights with a sampling weight of zero are never picked.
+ * Lights are identified by their index within the scene (see
+ * @ref Light::index ), which must be assigned before building the hierarchy.
+ */
+class LightBVH {
+    struct Node {
+        /// @brief The bounds of all lights within the subtree.
+        LightBounds bounds;
+        /// @brief For leaves, the index of the light, otherwise the index of
+        /// the second child (the first child directly follows its parent).
+        int childOrLight;
+        bool isLeaf;
+    };
+
+    /// @brief The nodes of the hierarchy, with the root at index zero.
+    std::vector<Node> m_nodes;
+    /// @brief The lights with bounds, referenced by the leaves.
+    std::vector<const Light *> m_boundedLights;
+
+    /// @brief Describes how a light is picked.
+    struct Entry {
+        const Light *light = nullptr;
+        /// @brief Whether the light is part of the hierarchy.
+        bool isBounded = false;
+        /// @brief For lights in the hierarchy, the path from the root to their
+        /// leaf, where bit @c i tells which child has been chosen at depth
+        /// @c i .
+        uint64_t bitTrail = 0;
+        /// @brief For lights without bounds, the probability of picking them.
+        float probability = 0;
+    };
+    /// @brief How each light is picked, indexed by @ref Light::index .
+    std::vector<Entry> m_entries;
+
+    /// @brief The lights without bounds, with their sampling weights.
+    std::vector<std::pair<const Light *, float>> m_infiniteLights;
+    /// @brief The total sampling weight of the lights without bounds.
+    float m_infiniteWeight = 0;
+    /// @brief The probability of picking a light without bounds.
+    float m_infiniteProbability = 0;
+
+    /// @brief Builds the subtree for a range of lights and returns the index
+    /// of its root node.
+    int build(std::vector<std::pair<int, LightBounds>> &lights, int begin,
+              int end, uint64_t bitTrail, int depth);
+
+    /// @brief Returns the entry of a light, or nothing if the light is not
+    /// part of this hierarchy.
+    const Entry *entry(const Light *light) const {
+        if (light == nullptr || light->index() < 0 ||
+            light->index() >= int(m_entries.size()))
+            return nullptr;
+        const Entry &entry = m_entries[light->index()];
+        return entry.light == light ? &entry : nullptr;
+    }
+
+public:
+    LightBVH(const std::vector<ref<Light>> &lights);
+
+    /// @brief Reports whether at least one light can be picked.
+    bool hasLights() const {
+        return !m_nodes.empty() || !m_infiniteLights.empty();
+    }
+
+    /**
+     * @brief Estimates how much light the lights within the given bounds
+     * can contribute to a point, which is zero if the point cannot receive
+     * light from them.
+     * @param normal The normal of the surface at the point (or zero, to
+     * disregard the orientation of the surface).
+     */
+    static float importance(const LightBounds &bounds, const Point &position,
+                            const Vector &normal);
+
+    /// @brief Randomly picks a light for the given point, using the random
+    /// number @c u .
+    LightSample sample(const Point &position, const Vector &normal,
+                       float u) const;
+    /// @brief Returns the probability of picking a light via @ref sample .
+    float probability(const Light *light, const Point &position,
+                      const Vector &normal) const;
+};
+
+} // namespace lightwave
@@ -1,10 +1,14 @@
 #include <lightwave/core.hpp>
+#include <lightwave/integrator.hpp>
 #include <lightwave/logger.hpp>
 #include <lightwave/registry.hpp>
 #include <catch_amalgamated.hpp>
 
 #include "parser.hpp"
+#include "partial.hpp"
+#include "server.hpp"
 
+#include <cstdio>
 #include <fstream>
 
 #ifdef LW_OS_WINDOWS
@@ -51,12 +55,65 @@ int main(int argc, const char *argv[]) {
 #endif
 
     try {
+        if (argc > 1 && std::string(argv[1]) == "--merge") {
+            // neotracer --merge output.exr partial1 partial2 ...
+            if (argc < 4)
+                lightwave_throw("usage: --merge <output.exr> <partials...>");
+            mergePartialRenders(argv[2], { argv + 3, argv + argc });
+            return 0;
+        }
+
+        if (argc > 1 && std::string(argv[1]) == "--serve") {
+            // neotracer --serve [socket]
+            runRenderServer(argc > 2 ? argv[2] : "");
+            return 0;
+        }
+
         if (argc <= 1 || *argv[1] == '-') {
             logger(EInfo, "running unit tests since no scene path was given");
             return runUnitTests(argc, argv);
         }
 
         std::filesystem::path scenePath = argv[1];
+        for (int i = 2; i < argc; i++) {
+            const std::string option = argv[i];
+            if (option == "--resume") {
+                resumeFromCheckpoints = true;
+            } else if (option == "--tiles" && i + 1 < argc) {
+                auto &partition = renderPartition;
+                if (std::sscanf(argv[++i],
+                                "%d/%d",
+                                &partition.blockIndex,
+                                &partition.blockCount) != 2 ||
+                    partition.blockIndex < 0 ||
+                    partition.blockIndex >= partition.blockCount)
+                    lightwave_throw("expected --tiles <index>/<count>");
+            } else if (option == "--samples" && i + 1 < argc) {
+                auto &partition = renderPartition;
+                if (std::sscanf(argv[++i],
+                                "%d:%d",
+                                &partition.firstSample,
+                                &partition.lastSample) != 2 ||
+                    partition.firstSample < 0 ||
+                    partition.lastSample <= partition.firstSample)
+                    lightwave_throw("expected --samples <first>:<last>");
+            } else if (option == "--region" && i + 1 < argc) {
+                Point2i min, max;
+                if (std::sscanf(argv[++i],
+                                "%d,%d,%d,%d",
+                                &min.x(),
+                                &min.y(),
+                                &max.x(),
+                                &max.y()) != 4 ||
+                    Bounds2i(min, max).isEmpty())
+                    lightwave_throw("expected --region <x0>,<y0>,<x1>,<y1>");
+                renderPartition.region = Bounds2i(min, max);
+            } else if (option == "--crop" && i + 1 < argc) {
+                renderOverrides.crop = CropWindow::parse(argv[++i]);
+            } else {
+                lightwave_throw("unknown option \"%s\"", option);
+            }
+        }
 
         SceneParser parser{ scenePath };
         for (auto &object : parser.objects()) {
@@ -0,0 +1,193 @@
+#include <lightwave/parallel.hpp>
+
+namespace lightwave {
+
+/// @brief The pool that the current thread works for, if any.
+static thread_local ThreadPool *currentPool = nullptr;
+/// @brief The index of the current thread within @c currentPool .
+static thread_local int currentWorker = -1;
+
+ThreadPool::ThreadPool(int numThreads) {
+    for (int i = 0; i <= numThreads; i++)
+        m_queues.push_back(std::make_unique<Queue>());
+
+    m_threads.reserve(numThreads);
+    for (int i = 0; i < numThreads; i++)
+        m_threads.emplace_back([this, i]() { work(i); });
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::unique_lock lock{ m_idleMutex };
+        m_stopping = true;
+    }
+    m_idle.notify_all();
+    for (auto &thread : m_threads)
+        thread.join();
+}
+
+ThreadPool &ThreadPool::global() {
+    static ThreadPool pool{ std::max(
+        1, int(std::thread::hardware_concurrency())) };
+    return pool;
+}
+
+void ThreadPool::submit(Task task) { enqueue(std::move(task), false); }
+
+void ThreadPool::enqueue(Task task, bool isHelper) {
+    // workers keep the tasks they create for themselves (until they are
+    // stolen), everyone else shares a single queue
+    Queue &queue =
+        *m_queues[currentPool == this ? currentWorker : numThreads()];
+    {
+        std::unique_lock lock{ queue.mutex };
+        (isHelper ? queue.helpers : queue.tasks).push_back(std::move(task));
+
+        // counted while the task is in its queue, so that waiting workers
+        // neither miss it nor wait for tasks that have been taken already
+        std::unique_lock idleLock{ m_idleMutex };
+        m_pendingTasks++;
+        if (isHelper)
+            m_pendingHelpers++;
+    }
+    m_idle.notify_one();
+    if (isHelper)
+        m_waiting.notify_one();
+}
+
+bool ThreadPool::pop(int queueIndex, bool helpersOnly, Task &task) {
+    const int numQueues = int(m_queues.size());
+    for (int offset = 0; offset < numQueues; offset++) {
+        Queue &queue = *m_queues[(queueIndex + offset) % numQueues];
+        std::unique_lock lock{ queue.mutex };
+
+        // helpers first, as some thread is waiting for their loop to finish
+        const bool isHelper     = !queue.helpers.empty();
+        std::deque<Task> &tasks = isHelper ? queue.helpers : queue.tasks;
+        if (tasks.empty() || (helpersOnly && !isHelper))
+            continue;
+
+        if (offset == 0) {
+            // the newest task of our own queue, whose data is most likely
+            // still in cache
+            task = std::move(tasks.back());
+            tasks.pop_back();
+        } else {
+            // steal the oldest task of some other queue, which also processes
+            // the tasks of external threads in the order they were submitted
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+
+        std::unique_lock idleLock{ m_idleMutex };
+        m_pendingTasks--;
+        if (isHelper)
+            m_pendingHelpers--;
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::work(int workerIndex) {
+    currentPool   = this;
+    currentWorker = workerIndex;
+
+    Task task;
+    while (true) {
+        if (pop(workerIndex, false, task)) {
+            task();
+            task = nullptr;
+            continue;
+        }
+
+        std::unique_lock lock{ m_idleMutex };
+        m_idle.wait(lock,
+                    [&]() { return m_stopping || m_pendingTasks > 0; });
+        if (m_stopping)
+            return;
+    }
+}
+
+void ThreadPool::parallelFor(int count,
+                             const std::function<void(int)> &body) {
+    if (count <= 0)
+        return;
+
+    // shared with the helper tasks, which might only start running after this
+    // call has already returned (and then find no work left)
+    struct Job {
+        ThreadPool *pool;
+        const std::function<void(int)> *body;
+        int count;
+        std::atomic<int> next     = 0;
+        std::atomic<int> finished = 0;
+
+        std::mutex mutex;
+        std::condition_variable done;
+        std::exception_ptr exception;
+        std::atomic<bool> failed = false;
+
+        void run() {
+            int index;
+            while ((index = next++) < count) {
+                if (!failed) {
+                    try {
+                        (*body)(index);
+                    } catch (...) {
+                        std::unique_lock lock{ mutex };
+                        if (!exception)
+                            exception = std::current_exception();
+                        failed = true;
+                    }
+                }
+
+                if (++finished == count) {
+                    {
+                        std::unique_lock lock{ mutex };
+                        done.notify_all();
+                    }
+                    std::unique_lock lock{ pool->m_idleMutex };
+                    pool->m_waiting.notify_all();
+                }
+            }
+        }
+    };
+
+    auto job   = std::make_shared<Job>();
+    job->pool  = this;
+    job->body  = &body;
+    job->count = count;
+
+    // the calling thread takes part in the work as well
+    const int helpers = std::min(count, numThreads()) - 1;
+    for (int i = 0; i < helpers; i++)
+        enqueue([job]() { job->run(); }, true);
+    job->run();
+
+    if (currentPool == this) {
+        // workers keep helping with other loops (e.g., nested ones) while the
+        // remaining indices of ours are processed, instead of leaving their
+        // core idle. Other tasks are not run, as they might wait for the task
+        // that is running this loop.
+        Task task;
+        while (job->finished < count) {
+            if (pop(currentWorker, true, task)) {
+                task();
+                task = nullptr;
+                continue;
+            }
+
+            std::unique_lock lock{ m_idleMutex };
+            m_waiting.wait(lock, [&]() {
+                return job->finished == count || m_pendingHelpers > 0;
+            });
+        }
+    } else {
+        std::unique_lock lock{ job->mutex };
+        job->done.wait(lock, [&]() { return job->finished == count; });
+    }
+    if (job->exception)
+        std::rethrow_exception(job->exception);
+}
+
+} // namespace lightwave
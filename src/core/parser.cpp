@@ -1,4 +1,6 @@
-#include <ctpl_stl.h>
+#include <lightwave/hash.hpp>
+#include <lightwave/logger.hpp>
+#include <lightwave/parallel.hpp>
 #include <lightwave/properties.hpp>
 #include <lightwave/registry.hpp>
 #include <lightwave/transform.hpp>
@@ -11,8 +13,6 @@
 
 #include "parser.hpp"
 
-ctpl::thread_pool pool(2 * std::thread::hardware_concurrency());
-
 namespace lightwave {
 
 struct SceneParser::Node
@@ -29,8 +29,14 @@ struct SceneParser::Node
 
     virtual void enter() {}
     virtual void attribute(const std::string &name, const std::string &value) {}
+    /**
+     * @brief Adds a child object to this node.
+     * @param isReusable Whether the child (and everything within it) can be
+     * shared with a later load of the scene.
+     */
     virtual void addChild(const std::shared_future<ref<Object>> &object,
-                          const std::string &name) {
+                          const std::string &name, uint64_t fingerprint,
+                          bool isReusable) {
         lightwave_throw("children are not supported by this node");
     }
     virtual void close() {}
@@ -39,7 +45,13 @@ struct SceneParser::Node
 };
 
 struct SceneParser::RootNode : public SceneParser::Node {
-    std::map<std::string, std::shared_future<ref<Object>>> namedObjects;
+    struct NamedObject {
+        std::shared_future<ref<Object>> object;
+        uint64_t fingerprint;
+        bool isReusable;
+    };
+
+    std::map<std::string, NamedObject> namedObjects;
     std::vector<std::shared_future<ref<Object>>> objectFutures;
     std::filesystem::path filepath;
     SceneParser &sceneParser;
@@ -49,11 +61,12 @@ struct SceneParser::RootNode : public SceneParser::Node {
         : Node(nullptr), filepath(filepath), sceneParser(sceneParser) {}
 
     void nameObject(const std::string &name,
-                    const std::shared_future<ref<Object>> &object) {
-        namedObjects[name] = object;
+                    const std::shared_future<ref<Object>> &object,
+                    uint64_t fingerprint, bool isReusable) {
+        namedObjects[name] = { object, fingerprint, isReusable };
     }
 
-    const std::shared_future<ref<Object>> &lookup(const std::string &name) {
+    const NamedObject &lookup(const std::string &name) {
         auto it = namedObjects.find(name);
         if (it == namedObjects.end()) {
             lightwave_throw("could not find an object named \"%s\"", name);
@@ -66,7 +79,8 @@ struct SceneParser::RootNode : public SceneParser::Node {
     RootNode &getRoot() override { return *this; }
 
     void addChild(const std::shared_future<ref<Object>> &object,
-                  const std::string &name) override {
+                  const std::string &name, uint64_t fingerprint,
+                  bool isReusable) override {
         objectFutures.push_back(object);
     }
 
@@ -89,11 +103,51 @@ struct SceneParser::ObjectNode : public SceneParser::Node {
 
     ref<Transform> transform;
 
+    /// @brief Identifies the object by everything it is created from (its
+    /// tag, attributes, parameters, children and the files it refers to), so
+    /// that unchanged objects can be reused when a scene is loaded again.
+    hash::fnv1a fingerprint;
+    /// @brief Whether all children can be shared with a later load of the
+    /// scene.
+    bool childrenAreReusable = true;
+
     ObjectNode(const std::string &tag, const ref<Node> &parent)
         : Node(parent), tag(tag),
-          properties(parent->getFilePath().remove_filename()) {}
+          properties(parent->getFilePath().remove_filename()) {
+        fingerprint << tag;
+    }
+
+    /// @brief Adds an attribute or parameter to the fingerprint. Files are
+    /// identified by their path, size and modification time.
+    void addToFingerprint(const std::string &tag, const std::string &key,
+                          const std::string &value) {
+        fingerprint << tag << key << value;
+        if (key == "filename") {
+            const auto path = getFilePath().remove_filename() / value;
+            std::error_code error;
+            fingerprint << path.string()
+                        << uint64_t(std::filesystem::file_size(path, error))
+                        << uint64_t(std::filesystem::last_write_time(path, error)
+                                        .time_since_epoch()
+                                        .count());
+        }
+    }
+
+    /// @brief Whether this object is never modified after it has been
+    /// created, and can hence be shared with a later load of the scene. This
+    /// excludes instances (as lights attach themselves to them), as well as
+    /// objects that contain them (e.g., groups of instances), since reusing
+    /// those would keep the instances of the previous load alive.
+    bool isReusable() const {
+        const bool isReusableKind =
+            tag == "bsdf" || tag == "camera" || tag == "emission" ||
+            tag == "image" || tag == "shape" || tag == "texture" ||
+            tag == "transform";
+        return isReusableKind && childrenAreReusable;
+    }
 
     void attribute(const std::string &key, const std::string &value) override {
+        addToFingerprint("", key, value);
         if (key == "type") {
             type = value;
         } else if (key == "name") {
@@ -113,17 +167,47 @@ struct SceneParser::ObjectNode : public SceneParser::Node {
     }
 
     void addChild(const std::shared_future<ref<Object>> &object,
-                  const std::string &childName) override {
+                  const std::string &childName, uint64_t childFingerprint,
+                  bool isChildReusable) override {
         childFutures.push_back(std::make_pair(childName, object));
+        fingerprint << childName << childFingerprint;
+        childrenAreReusable &= isChildReusable;
     }
 
     void close() override {
-        ProgressReporter &progress = getRoot().sceneParser.m_progress;
+        SceneParser &sceneParser   = getRoot().sceneParser;
+        ProgressReporter &progress = sceneParser.m_progress;
+        const uint64_t key         = fingerprint;
         progress.update(0, 1);
 
+        if (isReusable()) {
+            auto it = sceneParser.m_previousObjects.find(key);
+            if (it != sceneParser.m_previousObjects.end()) {
+                // the children of an unchanged object are unchanged as well,
+                // and hence have been reused already
+                std::promise<ref<Object>> reused;
+                reused.set_value(it->second);
+                const auto object = reused.get_future().share();
+                sceneParser.m_reusable.emplace_back(key, object);
+                sceneParser.m_reusedCount++;
+                progress += 1;
+                if (id != "")
+                    getRoot().nameObject(id, object, key, true);
+                parent->addChild(object, name, key, true);
+                return;
+            }
+        }
+
         auto self = shared_from_this();
         std::shared_future<ref<Object>> object =
-            pool.push([this, self, &progress](int) {
+            ThreadPool::global().async([this,
+                                        self,
+                                        key,
+                                        &sceneParser,
+                                        &progress]() {
+                if (sceneParser.m_stopped)
+                    lightwave_throw("parsing was aborted");
+
                 // wait for all child objects to be constructed and add them to
                 // properties
                 for (const auto &child : childFutures) {
@@ -142,6 +226,7 @@ struct SceneParser::ObjectNode : public SceneParser::Node {
                                       : Registry::create(tag, type, properties);
                     if (id != "")
                         object->setId(id);
+                    object->setFingerprint(key);
                     progress += 1;
                     return object;
                 } catch (...) {
@@ -151,11 +236,14 @@ struct SceneParser::ObjectNode : public SceneParser::Node {
                                            location.column);
                 }
             });
+        sceneParser.m_tasks.push_back(object);
+        if (isReusable())
+            sceneParser.m_reusable.emplace_back(key, object);
         if (id != "") {
-            getRoot().nameObject(id, object);
+            getRoot().nameObject(id, object, key, isReusable());
         }
 
-        parent->addChild(object, name);
+        parent->addChild(object, name, key, isReusable());
     }
 };
 
@@ -189,6 +277,7 @@ struct SceneParser::PrimitiveNode : public SceneParser::Node {
         if (!parent_node) {
             lightwave_throw("parameters can only be specified on objects");
         }
+        parent_node->addToFingerprint(tag, name, value);
 
         if (tag == "float") {
             parent_node->properties.set(name, parse_string<float>(value));
@@ -223,8 +312,9 @@ struct SceneParser::IncludeNode : public SceneParser::Node {
     }
 
     void addChild(const std::shared_future<ref<Object>> &object,
-                  const std::string &name) override {
-        parent->addChild(object, name);
+                  const std::string &name, uint64_t fingerprint,
+                  bool isReusable) override {
+        parent->addChild(object, name, fingerprint, isReusable);
     }
 
     void close() override {
@@ -250,13 +340,16 @@ struct SceneParser::ReferenceNode : public SceneParser::Node {
     }
 
     void close() override {
-        this->parent->addChild(getRoot().lookup(id), name);
+        const auto &named = getRoot().lookup(id);
+        this->parent->addChild(
+            named.object, name, named.fingerprint, named.isReusable);
     }
 };
 
 struct SceneParser::TransformNode : public SceneParser::Node {
     std::string tag;
-    Transform *transform;
+    ObjectNode *object = nullptr;
+    Transform *transform = nullptr;
 
     // for matrix
     Matrix4x4 matrix;
@@ -274,6 +367,7 @@ struct SceneParser::TransformNode : public SceneParser::Node {
     TransformNode(const std::string &tag, const ref<Node> &parent)
         : Node(parent), tag(tag) {
         if (auto p = dynamic_cast<ObjectNode *>(parent.get())) {
+            object    = p;
             transform = p->transform.get();
         }
 
@@ -294,6 +388,7 @@ struct SceneParser::TransformNode : public SceneParser::Node {
 
     void attribute(const std::string &attr_key,
                    const std::string &attr_value) override {
+        object->addToFingerprint(tag, attr_key, attr_value);
         if (tag == "matrix") {
             if (attr_key == "value") {
                 this->matrix = parse_string<Matrix4x4>(attr_value);
@@ -351,6 +446,8 @@ struct SceneParser::TransformNode : public SceneParser::Node {
     }
 
     void close() override {
+        // marks the end of the operation, as the order matters
+        object->addToFingerprint(tag, "", "");
         if (tag == "matrix")
             transform->matrix(matrix);
         else if (tag == "translate")
@@ -421,18 +518,35 @@ void SceneParser::close() {
 }
 
 void SceneParser::stop() {
-    pool.clear_queue();
-    pool.stop(true);
+    // objects that have not started yet are skipped, but the ones that are
+    // being created still refer to the parser and need to be waited for
+    m_stopped = true;
+    for (const auto &task : m_tasks)
+        task.wait();
 }
 
-SceneParser::SceneParser(const std::filesystem::path &path)
-    : m_progress("parsing") {
+SceneParser::SceneParser(const std::filesystem::path &path,
+                         const ObjectCache &previousObjects)
+    : m_progress("parsing"), m_previousObjects(previousObjects) {
     m_stack.push(std::make_shared<RootNode>(m_objects, path, *this));
     XMLParser(*this, path);
     SceneParser::close();
     m_progress.finish();
+
+    for (const auto &[fingerprint, object] : m_reusable)
+        m_objectCache[fingerprint] = object.get();
+    if (!m_previousObjects.empty()) {
+        logger(EInfo,
+               "reused %d of %d objects from the previous load",
+               m_reusedCount,
+               m_reusable.size());
+    }
 }
 
 std::vector<ref<Object>> SceneParser::objects() const { return m_objects; }
 
+const SceneParser::ObjectCache &SceneParser::objectCache() const {
+    return m_objectCache;
+}
+
 } // namespace lightwave
@@ -4,7 +4,9 @@
 
 #include "xml.hpp"
 
+#include <atomic>
 #include <filesystem>
+#include <future>
 #include <map>
 #include <stack>
 #include <vector>
@@ -12,6 +14,11 @@
 namespace lightwave {
 
 class SceneParser : public XMLParser::Delegate {
+public:
+    /// @brief Objects that can be shared between loads of a scene, by the
+    /// fingerprint of their definition.
+    typedef std::map<uint64_t, ref<Object>> ObjectCache;
+
 protected:
     struct Node;
     struct RootNode;
@@ -24,6 +31,20 @@ protected:
     std::stack<ref<Node>> m_stack;
     std::vector<ref<Object>> m_objects;
     ProgressReporter m_progress;
+    /// @brief The objects that are being created by the thread pool.
+    std::vector<std::shared_future<ref<Object>>> m_tasks;
+    /// @brief Whether parsing has failed, in which case pending objects are
+    /// no longer created.
+    std::atomic<bool> m_stopped = false;
+
+    /// @brief The reusable objects of the previous load of the scene.
+    const ObjectCache m_previousObjects;
+    /// @brief The reusable objects of this load, by their fingerprint.
+    std::vector<std::pair<uint64_t, std::shared_future<ref<Object>>>>
+        m_reusable;
+    /// @brief How many objects have been taken from the previous load.
+    int m_reusedCount = 0;
+    ObjectCache m_objectCache;
 
     std::string resolveVariables(const std::string &value);
 
@@ -35,8 +56,18 @@ protected:
     void stop() override;
 
 public:
-    SceneParser(const std::filesystem::path &path);
+    /**
+     * @brief Loads the scene at the given path.
+     * @param previousObjects The reusable objects of an earlier load of the
+     * scene (see @ref objectCache), which are used instead of creating objects
+     * whose definition (including referenced files) has not changed.
+     */
+    SceneParser(const std::filesystem::path &path,
+                const ObjectCache &previousObjects = {});
     std::vector<ref<Object>> objects() const;
+    /// @brief Returns the reusable objects of this load, to be passed to the
+    /// next load of the scene.
+    const ObjectCache &objectCache() const;
 };
 
 } // namespace lightwave
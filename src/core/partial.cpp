@@ -0,0 +1,158 @@
+#include <lightwave/image.hpp>
+#include <lightwave/logger.hpp>
+
+#include "partial.hpp"
+
+#include <algorithm>
+#include <fstream>
+
+namespace lightwave {
+
+/// @brief Identifies partial render files and their version.
+static constexpr uint32_t PartialMagic   = 0x504c574c; // "LWLP"
+static constexpr uint32_t PartialVersion = 1;
+
+template <typename T> static void write(std::ostream &os, const T &value) {
+    os.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T> static T read(std::istream &is) {
+    T value{};
+    is.read(reinterpret_cast<char *>(&value), sizeof(T));
+    return value;
+}
+
+/// @brief Returns whether a block covers at least one pixel and lies within
+/// an image of the given resolution.
+static bool isWithin(const Bounds2i &bounds, const Point2i &resolution) {
+    const Bounds2i image{ Point2i(0), resolution };
+    return !bounds.isEmpty() && image.includes(bounds.min()) &&
+           image.includes(bounds.max());
+}
+
+void PartialRender::save(const std::filesystem::path &path) const {
+    logger(EInfo, "saving partial render %s", path);
+    std::ofstream file{ path, std::ios::binary };
+    write(file, PartialMagic);
+    write(file, PartialVersion);
+    write(file, resolution);
+    write(file, uint64_t(blocks.size()));
+    for (const Block &block : blocks) {
+        write(file, block.bounds);
+        write(file, block.firstSample);
+        write(file, block.sampleCount);
+        file.write(reinterpret_cast<const char *>(block.sums.data()),
+                   block.sums.size() * sizeof(Color));
+    }
+    if (!file)
+        lightwave_throw("could not write partial render %s", path);
+}
+
+void PartialRender::load(const std::filesystem::path &path) {
+    std::ifstream file{ path, std::ios::binary };
+    if (!file)
+        lightwave_throw("could not open partial render %s", path);
+    if (read<uint32_t>(file) != PartialMagic ||
+        read<uint32_t>(file) != PartialVersion)
+        lightwave_throw("%s is not a valid partial render", path);
+
+    resolution = read<Point2i>(file);
+    blocks.resize(read<uint64_t>(file));
+    for (Block &block : blocks) {
+        block.bounds      = read<Bounds2i>(file);
+        block.firstSample = read<int>(file);
+        block.sampleCount = read<int>(file);
+        if (!file)
+            break;
+        if (!isWithin(block.bounds, resolution))
+            lightwave_throw("partial render %s has a block outside of the "
+                            "image",
+                            path);
+        block.sums.resize(block.bounds.diagonal().product());
+        file.read(reinterpret_cast<char *>(block.sums.data()),
+                  block.sums.size() * sizeof(Color));
+    }
+    if (!file)
+        lightwave_throw("partial render %s is truncated", path);
+}
+
+Image mergePartialRenders(const std::vector<PartialRender> &renders) {
+    if (renders.empty())
+        lightwave_throw("no partial renders given to merge");
+
+    const Point2i resolution = renders.front().resolution;
+    std::vector<const PartialRender::Block *> blocks;
+    for (const auto &render : renders) {
+        if (render.resolution != resolution)
+            lightwave_throw("partial renders have different resolutions");
+        for (const auto &block : render.blocks) {
+            if (!isWithin(block.bounds, resolution))
+                lightwave_throw("partial render has a block outside of the "
+                                "image");
+            if (block.sums.size() != size_t(block.bounds.diagonal().product()))
+                lightwave_throw("partial render has a block whose size does "
+                                "not match its bounds");
+            if (block.firstSample < 0 || block.sampleCount <= 0)
+                lightwave_throw("partial render has a block with an invalid "
+                                "sample range");
+            blocks.push_back(&block);
+        }
+    }
+
+    // the order of summation needs to match that of a single render
+    std::stable_sort(blocks.begin(), blocks.end(), [](auto a, auto b) {
+        return a->firstSample < b->firstSample;
+    });
+
+    std::vector<Color> sums(resolution.x() * resolution.y());
+    std::vector<int> sampleCounts(sums.size(), 0);
+    // the end of the last sample range of each pixel, which the next range
+    // must not start before as blocks are sorted by their first sample
+    std::vector<int> sampleEnds(sums.size(), 0);
+    for (const auto *block : blocks) {
+        auto sum = block->sums.begin();
+        for (auto pixel : block->bounds) {
+            const int index = pixel.y() * resolution.x() + pixel.x();
+            if (block->firstSample < sampleEnds[index])
+                lightwave_throw("partial renders share samples of pixel "
+                                "(%d, %d)",
+                                pixel.x(),
+                                pixel.y());
+            sums[index] += *sum++;
+            sampleCounts[index] += block->sampleCount;
+            sampleEnds[index] = block->firstSample + block->sampleCount;
+        }
+    }
+
+    Image image{ resolution };
+    int missingPixels = 0;
+    for (auto pixel : Bounds2i(Point2i(0), resolution)) {
+        const int index = pixel.y() * resolution.x() + pixel.x();
+        if (sampleCounts[index] == 0) {
+            missingPixels++;
+            continue;
+        }
+        image(pixel) = (1.0f / sampleCounts[index]) * sums[index];
+    }
+    if (missingPixels > 0) {
+        logger(EWarn,
+               "%d pixels are not covered by any partial render",
+               missingPixels);
+    }
+    return image;
+}
+
+void mergePartialRenders(const std::filesystem::path &output,
+                         const std::vector<std::filesystem::path> &partials) {
+    std::vector<PartialRender> renders(partials.size());
+    for (size_t i = 0; i < partials.size(); i++) {
+        renders[i].load(partials[i]);
+        if (renders[i].resolution != renders.front().resolution)
+            lightwave_throw("%s has a different resolution than %s",
+                            partials[i],
+                            partials.front());
+    }
+    mergePartialRenders(renders).saveAt(output);
+}
+
+} // namespace lightwave
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <lightwave/color.hpp>
+#include <lightwave/core.hpp>
+#include <lightwave/image.hpp>
+#include <lightwave/math.hpp>
+
+#include <filesystem>
+#include <vector>
+
+namespace lightwave {
+
+/**
+ * @brief The unnormalized result of rendering some part of an image (i.e.,
+ * some blocks and a range of samples), as produced by one of several processes
+ * that share the work of rendering a single image.
+ */
+struct PartialRender {
+    /// @brief A block of pixels that has been rendered.
+    struct Block {
+        Bounds2i bounds;
+        /// @brief The index of the first sample that has been taken.
+        int firstSample;
+        /// @brief The number of samples taken for each pixel.
+        int sampleCount;
+        /// @brief The sum of the samples of each pixel, in row-major order.
+        std::vector<Color> sums;
+    };
+
+    Point2i resolution;
+    std::vector<Block> blocks;
+
+    /// @brief Writes the partial render to a file (in native byte order).
+    void save(const std::filesystem::path &path) const;
+    /// @brief Reads a partial render from a file.
+    void load(const std::filesystem::path &path);
+};
+
+/**
+ * @brief Combines partial renders of the same image into the final image.
+ * The samples of each pixel are summed up in the order of their sample index
+ * and normalized the same way as when rendering in one process, so splitting
+ * an image into blocks produces exactly the same result.
+ * @throws If blocks lie outside of the image, or if blocks that cover the
+ * same pixel share samples (which would count them twice).
+ */
+Image mergePartialRenders(const std::vector<PartialRender> &renders);
+
+/// @brief Loads partial renders from files and saves the image that results
+/// from merging them (see above).
+void mergePartialRenders(const std::filesystem::path &output,
+                         const std::vector<std::filesystem::path> &partials);
+
+} // namespace lightwave
@@ -6,92 +6,77 @@
 #include <lightwave/shape.hpp>
 #include <lightwave/instance.hpp>
 #include <lightwave/profiler.hpp>
+#include <lightwave/warp.hpp>
 
-#include <unordered_map>
+#include "lightbvh.hpp"
 
 namespace lightwave {
 
 class Scene::LightSampling {
-    struct DistributionElement {
-        const Light *light;
-        float probability;
-        float cdf;
-    };
-
-    /// @brief References to all lights, to maintain memory ownership.
+    /// @brief References to all lights, to maintain memory ownership, in the
+    /// order of their indices (see @ref Light::index ).
     std::vector<ref<Light>> m_lights;
-    /// @brief A fast lookup table to query how likely a light is to be sampled.
-    std::unordered_map<const Light *, float> m_probabilities;
-    /// @brief The distribution used for sampling.
-    std::vector<DistributionElement> m_distribution;
+    /// @brief The distribution used for sampling, with one bin per light.
+    AliasTable m_distribution;
 
 public:
-    LightSampling(const std::vector<ref<Light>> &lights)
+    LightSampling(const std::vector<ref<Light>> &lights,
+                  const Bounds &sceneBounds)
     : m_lights(lights) {
-        float cummulativeWeight = 0;
-
+        // lights are picked proportionally to their power, unless they do not
+        // want to be sampled (i.e., have a weight of zero)
+        std::vector<float> weights;
+        weights.reserve(lights.size());
         for (const auto &light : lights) {
             const float weight = light->samplingWeight();
-            if (weight == 0) {
-                // this light does not want to be sampled, so do not add
-                // it to the distribution and set its probability to 0
-                m_probabilities.insert(std::make_pair(light.get(), 0));
-                continue;
-            }
-
-            cummulativeWeight += weight;
-            m_distribution.emplace_back(DistributionElement {
-                light.get(),
-                weight,
-                cummulativeWeight
-            });
-        }
-
-        // normalize the distribution so that probability and cdf are in the range [0,1]
-        for (auto &element : m_distribution) {
-            element.probability /= cummulativeWeight;
-            element.cdf /= cummulativeWeight;
-
-            // add light to lookup table so that the probability can be queried efficiently
-            m_probabilities[element.light] = element.probability;
+            weights.push_back(
+                weight == 0 ? 0 : weight * light->power(sceneBounds));
         }
+        m_distribution = AliasTable(weights);
     }
 
     bool hasLights() const { return !m_lights.empty(); }
 
     LightSample sample(Sampler &rng) const {
         if (m_distribution.empty()) return LightSample::invalid();
-        const auto cdf = rng.next();
-        const auto element = std::upper_bound(
-            m_distribution.begin(),
-            m_distribution.end(),
-            cdf,
-            [](float value, const DistributionElement &element) {
-                return value < element.cdf;
-            }
-        );
+        const int index = m_distribution.sample(rng.next2D());
         return {
-            .light = element->light,
-            .probability = element->probability,
+            .light = m_lights[index].get(),
+            .probability = m_distribution.probability(index),
         };
     }
 
     float probability(const Light *light) const {
-        if (light == nullptr) return 0;
-
-        const auto it = m_probabilities.find(light);
-        if (it == m_probabilities.end()) return 0;
-        return it->second;
+        if (light == nullptr || m_distribution.empty()) return 0;
+
+        // the index is verified, in case the light belongs to another scene
+        const int index = light->index();
+        if (index < 0 || index >= int(m_lights.size()) ||
+            m_lights[index].get() != light)
+            return 0;
+        return m_distribution.probability(index);
     }
 };
 
 Scene::Scene(const Properties &properties) {
-    m_camera     = properties.getChild<Camera>();
+    m_cameras    = properties.getChildren<Camera>();
+    if (m_cameras.empty())
+        lightwave_throw("scenes need at least one <camera /> child");
     m_background = properties.getOptionalChild<BackgroundLight>();
-    m_lightSampling = std::make_shared<LightSampling>(properties.getChildren<Light>());
     m_lights = properties.getChildren<Light>();
+    // the per-light data of the light sampling structures is looked up by
+    // these indices
+    for (int index = 0; index < int(m_lights.size()); index++)
+        m_lights[index]->setIndex(index);
 
     const std::vector<ref<Shape>> entities = properties.getChildren<Shape>();
+    // identifies the instances in AOV images, independent of the order in
+    // which they were loaded
+    int instanceIndex = 0;
+    for (const auto &entity : entities) {
+        if (auto instance = dynamic_cast<Instance *>(entity.get()))
+            instance->setIndex(++instanceIndex);
+    }
     if (entities.size() == 1) {
         m_shape = entities[0];
     } else {
@@ -100,6 +85,27 @@ Scene::Scene(const Properties &properties) {
     }
 
     m_shape->markAsVisible();
+
+    // lights that are infinitely far away are weighted by how much of their
+    // light reaches the scene, for which the scene needs finite bounds
+    Bounds sceneBounds     = m_shape->getBoundingBox();
+    const float sceneSize  = sceneBounds.diagonal().length();
+    if (!(sceneSize > 0 && sceneSize < Infinity))
+        sceneBounds = Bounds(Point(-1), Point(1));
+    m_lightSampling = std::make_shared<LightSampling>(m_lights, sceneBounds);
+
+    enum class LightSamplingMode {
+        Power,
+        BVH,
+    };
+    // clang-format off
+    const auto mode = properties.getEnum<LightSamplingMode>("lightSampling", LightSamplingMode::BVH, {
+        { "power", LightSamplingMode::Power },
+        { "bvh", LightSamplingMode::BVH },
+    });
+    // clang-format on
+    if (mode == LightSamplingMode::BVH)
+        m_lightHierarchy = std::make_shared<LightBVH>(m_lights);
 }
 
 std::string Scene::toString() const {
@@ -107,7 +113,7 @@ std::string Scene::toString() const {
                        "  camera = %s,\n"
                        "  shape = %s,\n"
                        "]",
-                       indent(m_camera), indent(m_shape));
+                       indent(camera()), indent(m_shape));
 }
 
 Intersection Scene::intersect(const Ray &ray, Sampler &rng) const {
@@ -118,15 +124,13 @@ Intersection Scene::intersect(const Ray &ray, Sampler &rng) const {
     if (!its) {
         its.background = m_background.get();
     }
-    its.lightProbability = m_lightSampling->probability(its.light());
     return its;
 }
 
 bool Scene::intersect(const Ray &ray, float tMax, Sampler &rng) const {
     PROFILE("Shadow ray")
 
-    Intersection its(-ray.direction, tMax * (1 - Epsilon));
-    return m_shape->intersect(ray, its, rng);
+    return m_shape->occluded(ray, tMax * (1 - Epsilon), rng);
 }
 
 LightSample Scene::sampleLight(Sampler &rng) const {
@@ -135,6 +139,27 @@ LightSample Scene::sampleLight(Sampler &rng) const {
     return m_lightSampling->sample(rng);
 }
 
+LightSample Scene::sampleLight(const SurfaceEvent &surface,
+                               Sampler &rng) const {
+    if (!m_lightHierarchy)
+        return sampleLight(rng);
+
+    PROFILE("Pick light")
+
+    return m_lightHierarchy->sample(
+        surface.position, surface.shadingNormal, rng.next());
+}
+
+float Scene::lightSelectionProbability(const Light *light,
+                                       const SurfaceEvent &surface) const {
+    if (!m_lightHierarchy)
+        return m_lightSampling->probability(light);
+    if (light == nullptr)
+        return 0;
+    return m_lightHierarchy->probability(
+        light, surface.position, surface.shadingNormal);
+}
+
 bool Scene::hasLights() const {
     return m_lightSampling->hasLights();
 }
@@ -142,8 +167,9 @@ bool Scene::hasLights() const {
 Bounds Scene::getBoundingBox() const { return m_shape->getBoundingBox(); }
 
 float Scene::lightSelectionProbability(const Light *light) const {
-    return float(1) / m_lights.size();
+    return m_lightSampling->probability(light);
+}
 
 } // namespace lightwave
-}
+
 REGISTER_CLASS(Scene, "scene", "default")
@@ -0,0 +1,429 @@
+#include <lightwave/integrator.hpp>
+#include <lightwave/logger.hpp>
+
+#include "parser.hpp"
+#include "server.hpp"
+
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#ifndef LW_OS_WINDOWS
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace lightwave {
+
+namespace {
+
+/// @brief Someone who sends jobs to the server and receives the replies.
+class Client {
+public:
+    virtual ~Client() {}
+    /// @brief Sends a line of text to the client.
+    virtual void send(const std::string &line) = 0;
+};
+
+/// @brief A client that sends jobs over the standard input.
+class ConsoleClient : public Client {
+    std::mutex m_mutex;
+    std::ostream &m_output;
+
+public:
+    ConsoleClient(std::ostream &output) : m_output(output) {}
+
+    void send(const std::string &line) override {
+        std::unique_lock lock{ m_mutex };
+        m_output << line << std::endl;
+    }
+};
+
+#ifndef LW_OS_WINDOWS
+/// @brief A client that is connected to the socket of the server.
+class SocketClient : public Client {
+    std::mutex m_mutex;
+    int m_socket;
+    /// @brief Received data that does not form a complete line yet.
+    std::string m_buffer;
+
+public:
+    /// @brief Set once the client has disconnected.
+    std::atomic<bool> finished = false;
+
+    SocketClient(int socket) : m_socket(socket) {}
+    ~SocketClient() { ::close(m_socket); }
+
+    void send(const std::string &line) override {
+        std::unique_lock lock{ m_mutex };
+        const std::string data = line + "\n";
+        int flags              = 0;
+#ifdef MSG_NOSIGNAL
+        // the client might have disconnected already
+        flags = MSG_NOSIGNAL;
+#endif
+        for (size_t sent = 0; sent < data.size();) {
+            const auto result = ::send(
+                m_socket, data.data() + sent, data.size() - sent, flags);
+            if (result <= 0)
+                return;
+            sent += result;
+        }
+    }
+
+    /// @brief Waits for the next line sent by the client.
+    /// @return False if the client has disconnected.
+    bool readLine(std::string &line) {
+        size_t end;
+        while ((end = m_buffer.find('\n')) == std::string::npos) {
+            char data[4096];
+            const auto result = ::recv(m_socket, data, sizeof(data), 0);
+            if (result < 0 && errno == EINTR)
+                continue;
+            if (result <= 0)
+                return false;
+            m_buffer.append(data, result);
+        }
+        line = m_buffer.substr(0, end);
+        m_buffer.erase(0, end + 1);
+        return true;
+    }
+
+    /// @brief Stops waiting for further lines.
+    void disconnect() { ::shutdown(m_socket, SHUT_RDWR); }
+};
+#endif
+
+/// @brief Joins the messages of an exception and all exceptions nested in it.
+std::string describe(const std::exception &e) {
+    try {
+        std::rethrow_if_nested(e);
+    } catch (const std::exception &nestedException) {
+        return std::string(e.what()) + ": " + describe(nestedException);
+    } catch (...) {
+    }
+    return e.what();
+}
+
+struct Job {
+    int id;
+    std::filesystem::path scene;
+    RenderOverrides overrides;
+    std::shared_ptr<Client> client;
+};
+
+class RenderServer {
+    std::mutex m_mutex;
+    std::condition_variable m_queueChanged;
+    std::deque<Job> m_queue;
+    bool m_stopping = false;
+    int m_nextJob   = 1;
+
+    struct LoadedScene {
+        std::filesystem::file_time_type modificationTime;
+        std::vector<ref<Object>> objects;
+        /// @brief The objects that can be reused by the next load.
+        SceneParser::ObjectCache objectCache;
+    };
+    /// @brief The scenes that have been loaded, by canonical path (only used
+    /// by the render thread).
+    std::map<std::filesystem::path, LoadedScene> m_scenes;
+
+    /// @brief Returns the objects of a scene, which is only loaded again if
+    /// its file has been modified since it was last loaded (in which case the
+    /// objects whose definition has not changed are reused).
+    const std::vector<ref<Object>> &load(const std::filesystem::path &path) {
+        const auto canonicalPath    = std::filesystem::canonical(path);
+        const auto modificationTime = last_write_time(canonicalPath);
+
+        auto &scene = m_scenes[canonicalPath];
+        if (!scene.objects.empty() &&
+            scene.modificationTime == modificationTime) {
+            logger(EInfo, "reusing loaded scene %s", canonicalPath);
+            return scene.objects;
+        }
+
+        // the outdated objects are released first, so that only the reusable
+        // ones are kept alive while loading
+        scene.objects.clear();
+        SceneParser parser{ canonicalPath, scene.objectCache };
+        scene = { modificationTime, parser.objects(), parser.objectCache() };
+        return scene.objects;
+    }
+
+    void render(const Job &job) {
+        const Timer timer;
+        // the listener is called concurrently by render threads, and might
+        // still be running after the job has finished
+        struct ReportedProgress {
+            std::mutex mutex;
+            std::map<std::string, int> percents;
+        };
+        const auto reported = std::make_shared<ReportedProgress>();
+        logger.setProgressListener([reported, id = job.id, client = job.client](
+                                       const std::string &task,
+                                       float progress) {
+            // only report full percents, as tasks progress in small steps
+            const int percent = int(100 * progress);
+            {
+                std::unique_lock lock{ reported->mutex };
+                auto it = reported->percents.find(task);
+                if (it != reported->percents.end() && it->second == percent)
+                    return;
+                reported->percents[task] = percent;
+            }
+            client->send(tfm::format("progress %d %s %d", id, task, percent));
+        });
+
+        try {
+            const auto &objects = load(job.scene);
+            renderOverrides     = job.overrides;
+            for (const auto &object : objects) {
+                if (auto executable = dynamic_cast<Executable *>(object.get()))
+                    executable->execute();
+            }
+            job.client->send(
+                tfm::format("done %d %.3f", job.id, timer.getElapsedTime()));
+        } catch (const std::exception &e) {
+            const std::string message = describe(e);
+            logger(EError, "job %d failed: %s", job.id, message);
+            job.client->send(tfm::format("error %d %s", job.id, message));
+        }
+
+        renderOverrides = {};
+        logger.setProgressListener(nullptr);
+    }
+
+public:
+    /**
+     * @brief Handles a line of text sent by a client, which is either a job
+     * that is added to the queue or a request to stop the server.
+     * @return False if the server should stop.
+     */
+    bool handle(const std::string &line,
+                const std::shared_ptr<Client> &client) {
+        std::istringstream stream{ line };
+        std::string command;
+        if (!(stream >> command))
+            return true;
+        if (command == "quit") {
+            stop();
+            return false;
+        }
+        if (command != "render") {
+            client->send(
+                tfm::format("error - unknown command \"%s\"", command));
+            return true;
+        }
+
+        Job job;
+        job.client = client;
+        {
+            std::unique_lock lock{ m_mutex };
+            job.id = m_nextJob++;
+        }
+
+        std::string scene, option;
+        stream >> scene;
+        job.scene = scene;
+        while (stream >> option) {
+            const size_t separator  = option.find('=');
+            const std::string key   = option.substr(0, separator);
+            const std::string value = separator == std::string::npos
+                                          ? ""
+                                          : option.substr(separator + 1);
+            auto &overrides = job.overrides;
+            bool isValid    = !value.empty();
+            if (key == "camera") {
+                overrides.camera = value;
+            } else if (key == "spp") {
+                isValid &= std::sscanf(value.c_str(),
+                                       "%d",
+                                       &overrides.samplesPerPixel) == 1 &&
+                           overrides.samplesPerPixel > 0;
+            } else if (key == "resolution") {
+                isValid &= std::sscanf(value.c_str(),
+                                       "%dx%d",
+                                       &overrides.resolution.x(),
+                                       &overrides.resolution.y()) == 2 &&
+                           overrides.resolution.x() > 0 &&
+                           overrides.resolution.y() > 0;
+            } else if (key == "output") {
+                overrides.output = value;
+            } else if (key == "crop") {
+                try {
+                    overrides.crop = CropWindow::parse(value);
+                } catch (const std::exception &) {
+                    isValid = false;
+                }
+            } else {
+                isValid = false;
+            }
+
+            if (!isValid) {
+                client->send(tfm::format(
+                    "error %d invalid option \"%s\"", job.id, option));
+                return true;
+            }
+        }
+        if (scene.empty()) {
+            client->send(tfm::format(
+                "error %d expected render <scene.xml> [options...]", job.id));
+            return true;
+        }
+
+        {
+            std::unique_lock lock{ m_mutex };
+            if (m_stopping) {
+                client->send(
+                    tfm::format("error %d server is stopping", job.id));
+                return false;
+            }
+            m_queue.push_back(job);
+        }
+        client->send(tfm::format("queued %d", job.id));
+        m_queueChanged.notify_all();
+        return true;
+    }
+
+    /// @brief Renders jobs until the server is stopped and all queued jobs
+    /// are done.
+    void run() {
+        while (true) {
+            Job job;
+            {
+                std::unique_lock lock{ m_mutex };
+                m_queueChanged.wait(
+                    lock, [&]() { return m_stopping || !m_queue.empty(); });
+                if (m_queue.empty())
+                    return;
+                job = std::move(m_queue.front());
+                m_queue.pop_front();
+            }
+            logger(EInfo, "starting job %d for %s", job.id, job.scene);
+            render(job);
+        }
+    }
+
+    /// @brief Stops accepting jobs, but finishes those that are queued.
+    void stop() {
+        {
+            std::unique_lock lock{ m_mutex };
+            m_stopping = true;
+        }
+        m_queueChanged.notify_all();
+    }
+};
+
+} // namespace
+
+void runRenderServer(const std::filesystem::path &socketPath) {
+#ifdef LW_OS_WINDOWS
+    if (!socketPath.empty())
+        lightwave_throw("the render server only supports the standard input "
+                        "on Windows");
+#endif
+
+    RenderServer server;
+    std::thread renderer{ [&]() { server.run(); } };
+
+    if (socketPath.empty()) {
+        // replies are written to the standard output, everything else
+        // (including the output at exit) to the standard error
+        std::ostream replies{ std::cout.rdbuf() };
+        std::cout.rdbuf(std::cerr.rdbuf());
+        logger(EInfo, "render server is reading jobs from the standard input");
+
+        auto client = std::make_shared<ConsoleClient>(replies);
+        std::string line;
+        while (std::getline(std::cin, line) && server.handle(line, client)) {
+        }
+        server.stop();
+        renderer.join();
+        return;
+    }
+
+#ifndef LW_OS_WINDOWS
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socketPath.native().size() >= sizeof(address.sun_path)) {
+        server.stop();
+        renderer.join();
+        lightwave_throw("socket path %s is too long", socketPath);
+    }
+    std::strcpy(address.sun_path, socketPath.c_str());
+
+    const int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    ::unlink(socketPath.c_str());
+    if (listener < 0 ||
+        ::bind(listener,
+               reinterpret_cast<const sockaddr *>(&address),
+               sizeof(address)) < 0 ||
+        ::listen(listener, 16) < 0) {
+        const std::string error = std::strerror(errno);
+        if (listener >= 0)
+            ::close(listener);
+        server.stop();
+        renderer.join();
+        lightwave_throw("could not listen on socket %s: %s", socketPath, error);
+    }
+    logger(EInfo, "render server is listening on %s", socketPath);
+
+    struct Connection {
+        std::shared_ptr<SocketClient> client;
+        std::thread reader;
+    };
+    std::vector<Connection> connections;
+    while (true) {
+        const int socket = ::accept(listener, nullptr, nullptr);
+        if (socket < 0) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            // the listener has been shut down by a quit request
+            break;
+        }
+
+        // clean up after clients that have disconnected
+        std::erase_if(connections, [](Connection &connection) {
+            if (!connection.client->finished)
+                return false;
+            connection.reader.join();
+            return true;
+        });
+
+        auto client = std::make_shared<SocketClient>(socket);
+        std::thread reader{ [&server, client, listener]() {
+            std::string line;
+            while (client->readLine(line)) {
+                if (!server.handle(line, client)) {
+                    // wakes up the accept loop
+                    ::shutdown(listener, SHUT_RDWR);
+                    break;
+                }
+            }
+            client->finished = true;
+        } };
+        connections.push_back({ client, std::move(reader) });
+    }
+
+    server.stop();
+    renderer.join();
+    for (auto &connection : connections) {
+        connection.client->disconnect();
+        connection.reader.join();
+    }
+    ::close(listener);
+    ::unlink(socketPath.c_str());
+#endif
+}
+
+} // namespace lightwave
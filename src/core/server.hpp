@@ -0,0 +1,37 @@
+#pragma once
+
+#include <lightwave/core.hpp>
+
+#include <filesystem>
+
+namespace lightwave {
+
+/**
+ * @brief Runs a render server, which keeps scenes loaded between render jobs
+ * so that small jobs (e.g., previews) do not pay for parsing the scene and
+ * building acceleration structures again.
+ *
+ * Jobs are sent as lines of text, and are rendered one after another (each
+ * using all threads) in the order they were received:
+ * @code
+ * render <scene.xml> [camera=<id>] [spp=<count>] [resolution=<w>x<h>]
+ *                    [output=<image.exr>] [crop=<x0>,<y0>,<x1>,<y1>]
+ * quit
+ * @endcode
+ * Relative scene paths are resolved against the working directory of the
+ * server. Scenes stay loaded until their file is modified, after which only
+ * objects whose definition has changed are created again (e.g., meshes,
+ * textures and the BVH over unchanged instances are reused). A quit request
+ * stops the server once all queued jobs are done. The server replies with
+ * lines of the form @code queued <job> @endcode, @code progress <job> <task>
+ * <percent> @endcode, @code done <job> <seconds> @endcode and
+ * @code error <job> <message> @endcode.
+ *
+ * @param socketPath The path of a Unix domain socket to accept clients on, or
+ * empty to read jobs from the standard input (in which case the log is
+ * written to the standard error, so that the standard output only contains
+ * replies).
+ */
+void runRenderServer(const std::filesystem::path &socketPath);
+
+} // namespace lightwave
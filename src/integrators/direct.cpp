@@ -19,8 +19,11 @@ public:
         Color throughput = Color(1.0f);
         const int m_depth = 2;
         for (int depth = 0; ; ++depth){
+            rng.startBounce(depth);
             // Primary ray intersection
             Intersection its = m_scene->intersect(primary_ray, rng);
+            if (depth == 0)
+                recordAovs(its);
 
             // Check for no intersection
             if(!its){  
@@ -37,7 +40,7 @@ public:
             // Direct Lighting
             if(m_scene->hasLights()){
                 // SampleLight function
-                LightSample light_sample = m_scene->sampleLight(rng);
+                LightSample light_sample = m_scene->sampleLight(its, rng);
                 if(!light_sample.isInvalid()){ // Removes segmentation fault
                     DirectLightSample dls = light_sample.light->sampleDirect(its.position, rng, its); 
                     // Tracing secondary ray
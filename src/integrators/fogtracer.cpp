@@ -68,7 +68,6 @@ public:
         int volume_counter = 0;
         float medium_throughput;
         float p_bsdf = Infinity, p_light = 0.0f;
-        float lightSelectionProb = m_scene->lightSelectionProbability(nullptr);
 
         // for (int depth = 0; ; ++depth){
         while(depth < m_depth){
@@ -110,7 +109,7 @@ public:
             if (depth == 0 || its.instance->light() == nullptr)
                 final_color += throughput * its.evaluateEmission().value;
             else if(m_mis){
-                p_light = GetSolidAngle(its.pdf, its.t, its.shadingFrame().normal, its.wo) * lightSelectionProb;
+                p_light = GetSolidAngle(its.pdf, its.t, its.shadingFrame().normal, its.wo) * m_scene->lightSelectionProbability(its.instance->light());
                 float mis_weight = BalancedHeuristic(p_bsdf, p_light);
                 final_color += mis_weight * throughput * its.evaluateEmission().value;
             }
@@ -143,10 +142,10 @@ public:
                         if(medium_transmittance != Color(0.f)) {
                             // ask about medium color
                             if(m_mis){
-                                p_light = dls.pdf * lightSelectionProb;
+                                p_light = dls.pdf * light_sample.probability;
                                 mis_weight = BalancedHeuristic(p_light, phase);
                             }
-                            final_color += mis_weight * medium_transmittance * (1 / lightSelectionProb) * medium_throughput * phase * dls.weight * medium_type->getColor();
+                            final_color += mis_weight * medium_transmittance * (1 / light_sample.probability) * medium_throughput * phase * dls.weight * medium_type->getColor();
                             // final_color += medium_throughput * medium_color * medium_transmittance * phase;
 
                         }
@@ -182,10 +181,10 @@ public:
                         float mis_weight = 1.0f; 
                         if(medium_transmittance != Color(0.f)) {
                             if (m_mis){
-                                p_light = dls.pdf * lightSelectionProb;
+                                p_light = dls.pdf * light_sample.probability;
                                 mis_weight = BalancedHeuristic(p_light, bsdf_eval.pdf);
                             }
-                            final_color += mis_weight * throughput * medium_transmittance * (1 / lightSelectionProb) * dls.weight * bsdf_eval.value;
+                            final_color += mis_weight * throughput * medium_transmittance * (1 / light_sample.probability) * dls.weight * bsdf_eval.value;
                             is_reflected = true;
                         // }
                     }
@@ -41,18 +41,31 @@ public:
         Color final_color = Color(0.0f);
         Color throughput = Color(1.0f);
         float p_bsdf = Infinity, p_light = 0.0f;
-        float lightSelectionProb = m_scene->lightSelectionProbability(nullptr);
+        // the surface the current ray started from, which determines how
+        // likely the light it hits was to be picked for direct lighting
+        SurfaceEvent previous;
 
         for (int depth = 0; ; ++depth){
+            rng.startBounce(depth);
             // Primary ray intersection
             Intersection its = m_scene->intersect(primary_ray, rng);
+            if (depth == 0)
+                recordAovs(its);
 
             // Check for no intersection
             if(!its){  
                 EmissionEval x = its.evaluateEmission();
                 // if (depth == 0 && its.background == nullptr)
                 //     return final_color;
-                final_color += throughput * x.value;
+                float mis_weight = 1.0f;
+                if (depth > 0 && m_mis && its.background && p_bsdf > 0){
+                    // the background might also have been sampled directly
+                    // (which is impossible for delta BSDFs reporting pdf 0)
+                    p_light = its.background->pdf(-its.wo) *
+                              m_scene->lightSelectionProbability(its.background, previous);
+                    mis_weight = BalancedHeuristic(p_bsdf, p_light);
+                }
+                final_color += mis_weight * throughput * x.value;
                 return final_color;
             }
 
@@ -62,7 +75,8 @@ public:
             if (depth == 0 || its.instance->light() == nullptr)
                 final_color += throughput * its.evaluateEmission().value;
             else if (m_mis){
-                p_light = GetSolidAngle(its.pdf, its.t, its.shadingFrame().normal, its.wo) * lightSelectionProb;
+                p_light = GetSolidAngle(its.pdf, its.t, its.shadingFrame().normal, its.wo) *
+                          m_scene->lightSelectionProbability(its.instance->light(), previous);
                 float mis_weight = BalancedHeuristic(p_bsdf, p_light);
                 final_color += mis_weight * throughput * its.evaluateEmission().value;
             }
@@ -72,7 +86,7 @@ public:
             // Direct Lighting
             if(m_scene->hasLights()){
                 // SampleLight function
-                LightSample light_sample = m_scene->sampleLight(rng);
+                LightSample light_sample = m_scene->sampleLight(its, rng);
                 if(!light_sample.isInvalid()){ // Removes segmentation fault
                     DirectLightSample dls = light_sample.light->sampleDirect(its.position, rng, its); 
                     // Tracing secondary ray
@@ -84,9 +98,9 @@ public:
                     if(!occluded){
                         float mis_weight = 1.0f;
                         if (m_mis){
-                            p_light = dls.pdf * lightSelectionProb;
+                            p_light = dls.pdf * light_sample.probability;
                             mis_weight = BalancedHeuristic(p_light, its.evaluateBsdf(dls.wi).pdf);
-                            final_color += mis_weight * throughput * (1 / lightSelectionProb) * dls.weight * bsdf_eval;
+                            final_color += mis_weight * throughput * (1 / light_sample.probability) * dls.weight * bsdf_eval;
                         }
                         else {
                             final_color += mis_weight * throughput * (1 / light_sample.probability) * dls.weight * bsdf_eval;
@@ -102,6 +116,7 @@ public:
             primary_ray = Ray(its.position, sample_.wi.normalized());
             throughput *= sample_.weight;
             p_bsdf = sample_.pdf;
+            previous = its;
         }
         return final_color;
     }
@@ -5,11 +5,39 @@ namespace lightwave {
 class AreaLight final : public Light {
 
     ref<Instance> m_shape;
+    /// @brief The total emitted power (as luminance), see @ref power .
+    float m_power;
+
+    /// @brief Estimates the emitted power, which is Pi times the emitted
+    /// radiance integrated over the surface, from a fixed set of surface
+    /// samples.
+    float estimatePower() const {
+        const Emission *emission = m_shape->emission();
+        if (!emission)
+            return 0;
+
+        constexpr int SampleCount = 256;
+        const auto rng            = std::static_pointer_cast<Sampler>(
+            Registry::create("sampler", "independent", Properties()));
+        rng->seed(0);
+
+        float power = 0;
+        for (int i = 0; i < SampleCount; i++) {
+            const AreaSample sample = m_shape->sampleArea(*rng);
+            if (sample.pdf > 0) {
+                power += emission->evaluate(sample.uv, Vector(0, 0, 1))
+                             .value.luminance() /
+                         sample.pdf;
+            }
+        }
+        return power * Pi / SampleCount;
+    }
 
 public:
     AreaLight(const Properties &properties) : Light(properties) {
         m_shape = properties.getChild<Instance>();
         m_shape->setLight(this);
+        m_power = estimatePower();
     }
 
     DirectLightSample sampleDirectMain(const Point &origin,
@@ -39,6 +67,17 @@ public:
 
     bool canBeIntersected() const override { return false; }
 
+    float power(const Bounds &sceneBounds) const override { return m_power; }
+
+    std::optional<LightBounds> bounds() const override {
+        return LightBounds{
+            .bounds           = m_shape->getBoundingBox(),
+            .normals          = m_shape->getNormalCone(),
+            .cosThetaEmission = 0,
+            .power            = m_power * m_samplingWeight,
+        };
+    }
+
     std::string toString() const override {
         return tfm::format(
             "AreaLight[\n"
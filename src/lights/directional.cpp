@@ -25,6 +25,12 @@ public:
 
     bool canBeIntersected() const override { return false; }
 
+    float power(const Bounds &sceneBounds) const override {
+        // the light that passes through a disk as large as the scene
+        const float radius = sceneBounds.diagonal().length() / 2;
+        return Pi * sqr(radius) * m_intensity.luminance();
+    }
+
     std::string toString() const override {
         return tfm::format(
             "DirectionalLight[\n"
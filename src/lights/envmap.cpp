@@ -4,57 +4,167 @@
 
 namespace lightwave {
 
+/**
+ * @brief A background light given by a texture in equirectangular projection.
+ *
+ * Directions are importance sampled proportionally to the luminance of the
+ * texture, so that small bright regions (like the sun) do not cause fireflies.
+ * For this, the texture is divided into a grid of cells (one per pixel for
+ * image textures), and each cell is weighted by the brightest texture value
+ * within it times the solid angle it covers.
+ */
 class EnvironmentMap final : public BackgroundLight {
     /// @brief The texture to use as background
     ref<Texture> m_texture;
     /// @brief An optional transform from local-to-world space
     ref<Transform> m_transform;
 
+    /// @brief The number of cells of the sampling grid in u and v direction.
+    Point2i m_resolution;
+    /// @brief The distribution over the cells of the grid, in row-major order.
+    AliasTable m_distribution;
+    /// @brief The luminance of the texture integrated over all directions.
+    float m_integratedLuminance = 0;
+
+    /// @brief The smallest grid that is used, so that the solid angle is
+    /// importance sampled even for textures that are not based on images.
+    static constexpr int MinimumResolution = 32;
+
+    /// @brief Transforms a direction from world to local coordinates.
+    Vector toLocal(const Vector &direction) const {
+        if (!m_transform)
+            return direction.normalized();
+        return m_transform->inverse(direction).normalized();
+    }
+
+    /// @brief Returns the texture coordinates of a local direction.
+    static Point2 directionToUv(const Vector &local) {
+        const float phi   = std::atan2(local.z(), local.x());
+        const float theta = safe_acos(local.y());
+        return { (Pi - phi) * Inv2Pi, theta * InvPi };
+    }
+
+    /// @brief Returns the local direction of given texture coordinates.
+    static Vector uvToDirection(const Point2 &uv) {
+        const float phi   = Pi - uv.x() * 2 * Pi;
+        const float theta = uv.y() * Pi;
+        const float sinTheta = std::sin(theta);
+        return { sinTheta * std::cos(phi),
+                 std::cos(theta),
+                 sinTheta * std::sin(phi) };
+    }
+
+    /// @brief Converts the probability of a cell into the density of
+    /// sampling a direction with the given sine of the polar angle.
+    float cellPdf(int cell, float sinTheta) const {
+        if (sinTheta <= 0)
+            return 0;
+        // the cells are sampled uniformly in texture space, which maps to the
+        // sphere with a Jacobian of 2 Pi^2 sin(theta)
+        return m_distribution.probability(cell) * m_resolution.x() *
+               m_resolution.y() / (2 * Pi * Pi * sinTheta);
+    }
+
+    /// @brief Returns the cell of the grid that contains the given texture
+    /// coordinates.
+    int cellIndex(const Point2 &uv) const {
+        const int x = clamp(int(uv.x() * m_resolution.x()), 0,
+                            m_resolution.x() - 1);
+        const int y = clamp(int(uv.y() * m_resolution.y()), 0,
+                            m_resolution.y() - 1);
+        return y * m_resolution.x() + x;
+    }
+
+    void buildDistribution() {
+        m_resolution =
+            elementwiseMax(m_texture->resolution(),
+                           Point2i(2 * MinimumResolution, MinimumResolution));
+        const int width  = m_resolution.x();
+        const int height = m_resolution.y();
+
+        // the texture is evaluated at the corners and the center of each
+        // cell, which covers the support of bilinear filtering
+        std::vector<float> corners((width + 1) * (height + 1));
+        for (int y = 0; y <= height; y++) {
+            for (int x = 0; x <= width; x++) {
+                corners[y * (width + 1) + x] =
+                    m_texture->evaluate(Point2(float(x) / width,
+                                               float(y) / height))
+                        .luminance();
+            }
+        }
+
+        std::vector<float> weights(width * height);
+        for (int y = 0; y < height; y++) {
+            const float sinTheta = std::sin((y + 0.5f) * Pi / height);
+            for (int x = 0; x < width; x++) {
+                const Point2 center{ (x + 0.5f) / width, (y + 0.5f) / height };
+                float luminance = m_texture->evaluate(center).luminance();
+                m_integratedLuminance += std::max(luminance, 0.f) * sinTheta;
+                for (int corner = 0; corner < 4; corner++) {
+                    luminance = std::max(
+                        luminance,
+                        corners[(y + corner / 2) * (width + 1) + x +
+                                corner % 2]);
+                }
+                weights[y * width + x] = std::max(luminance, 0.f) * sinTheta;
+            }
+        }
+        m_distribution = AliasTable(weights);
+        m_integratedLuminance *= 2 * Pi * Pi / (width * height);
+    }
+
 public:
     EnvironmentMap(const Properties &properties) : BackgroundLight(properties) {
         m_texture   = properties.getChild<Texture>();
         m_transform = properties.getOptionalChild<Transform>();
+        buildDistribution();
     }
 
     EmissionEval evaluate(const Vector &direction) const override {
-        Point2 warped = Point2(0);
-        // hints:
-        // * if (m_transform) { transform direction vector from world to local
-        // coordinates }    
-        // * find the corresponding pixel coordinate for the given local
-        // direction
-        // * make use of std::atan2 instead of tangent function.
-        // * check out the safe versions of sine and cosine, e.g. safe_acos
-        // in math.hpp to avoid problematic edge cases
-        Vector dir_temp;
-        if (m_transform)
-            dir_temp = m_transform->inverse(direction);
-
-        dir_temp = dir_temp.normalized();
-        float phi = std::atan2(dir_temp[2], dir_temp[0]);
-        float theta = safe_acos(dir_temp[1]);
-
-        float t_x = (Pi - phi) * Inv2Pi;
-        float t_y = theta * InvPi; 
-        warped = Point2(t_x, t_y);
         return {
-            .value = m_texture->evaluate(warped),
+            .value = m_texture->evaluate(directionToUv(toLocal(direction))),
         };
     }
 
+    float pdf(const Vector &direction) const override {
+        if (m_distribution.empty())
+            return 0;
+        const Vector local   = toLocal(direction);
+        const float sinTheta = safe_sqrt(1 - sqr(local.y()));
+        return cellPdf(cellIndex(directionToUv(local)), sinTheta);
+    }
+
+    float power(const Bounds &sceneBounds) const override {
+        // the light that reaches a disk as large as the scene from all sides
+        const float radius = sceneBounds.diagonal().length() / 2;
+        return Pi * sqr(radius) * m_integratedLuminance;
+    }
+
     DirectLightSample sampleDirect(const Point &origin,
                                    Sampler &rng) const override {
-        Point2 warped    = rng.next2D();
-        Vector direction = squareToUniformSphere(warped);
-        auto E           = evaluate(direction);
-        // implement better importance sampling here, if you ever need it
-        // (useful for environment maps with bright tiny light sources, like the
-        // sun for example)
+        if (m_distribution.empty())
+            return DirectLightSample::invalid();
+
+        const int cell       = m_distribution.sample(rng.next2D());
+        const Point2 jitter  = rng.next2D();
+        const Point2 uv      = { (cell % m_resolution.x() + jitter.x()) /
+                                    m_resolution.x(),
+                                (cell / m_resolution.x() + jitter.y()) /
+                                    m_resolution.y() };
+        const Vector local   = uvToDirection(uv);
+        const float sinTheta = std::sin(uv.y() * Pi);
+        const float pdf      = cellPdf(cell, sinTheta);
+        if (pdf == 0)
+            return DirectLightSample::invalid();
+
+        const Vector direction =
+            m_transform ? m_transform->apply(local).normalized() : local;
         return {
-            .wi = direction,
-            .weight = E.value * Inv4Pi,
+            .wi       = direction,
+            .weight   = m_texture->evaluate(uv) / pdf,
             .distance = Infinity,
-            .pdf = Infinity
+            .pdf      = pdf,
         };
     }
 
@@ -30,6 +30,19 @@ public:
 
     bool canBeIntersected() const override { return false; }
 
+    float power(const Bounds &sceneBounds) const override {
+        return m_power.luminance();
+    }
+
+    std::optional<LightBounds> bounds() const override {
+        return LightBounds{
+            .bounds           = Bounds(m_position, m_position),
+            .normals          = DirectionCone::entireSphere(),
+            .cosThetaEmission = 0,
+            .power            = m_power.luminance() * m_samplingWeight,
+        };
+    }
+
     std::string toString() const override {
         return tfm::format(
             "PointLight[\n"
@@ -0,0 +1,120 @@
+#include <lightwave.hpp>
+
+#include "sobol.hpp"
+
+#include <bit>
+
+namespace lightwave {
+
+/**
+ * @brief Generates a low-discrepancy sequence for each dimension, so that the
+ * samples of a pixel cover every dimension far more evenly than independent
+ * random numbers, which noticeably reduces noise (especially for direct
+ * lighting).
+ *
+ * Each dimension (or pair of dimensions for @ref next2D) uses the first two
+ * dimensions of the Sobol sequence, randomized by hash-based Owen scrambling
+ * whose seed depends on the pixel and the dimension ("padding"). The order of
+ * the samples is shuffled per dimension as well, which removes correlation
+ * between the dimensions. This follows Burley, "Practical Hash-based Owen
+ * Scrambling" (JCGT 2020).
+ *
+ * Dimensions are counted separately for the camera and each bounce of a path
+ * (see @ref Sampler::startBounce), so that the same sampling decisions use the
+ * same dimensions in all samples of a pixel.
+ *
+ * @note The sequence is stratified best if the number of samples per pixel is
+ * a power of two.
+ */
+class Sobol : public Sampler {
+    uint64_t m_seed;
+    /// @brief The hash of the pixel (and seed) that is being sampled.
+    uint64_t m_pixelHash;
+    /// @brief The index of the current sample, with its bits reversed.
+    uint32_t m_reversedIndex;
+    /// @brief The block of dimensions that is being used, which is zero for
+    /// the camera and one plus the depth for bounces of the path.
+    uint32_t m_block;
+    /// @brief The next dimension within the current block.
+    uint32_t m_dimension;
+
+    /// @brief Returns a hash that identifies the next dimension.
+    uint64_t nextDimensionHash() {
+        return sobol::mixBits(m_pixelHash ^
+                              ((uint64_t(m_block) << 32) | m_dimension++));
+    }
+
+    /// @brief Returns the index of the current sample after shuffling it for
+    /// a dimension (by Owen scrambling it), which keeps the first 2^k samples
+    /// a (0,k,2)-net.
+    uint32_t shuffledIndex(uint32_t seed) const {
+        return sobol::reverseBits(
+            sobol::laineKarrasPermutation(m_reversedIndex, seed));
+    }
+
+public:
+    Sobol(const Properties &properties) : Sampler(properties) {
+        m_seed = properties.get<int>("seed",
+                                     std::getenv("reference") ? 1337 : 420);
+        if (!std::has_single_bit(unsigned(m_samplesPerPixel))) {
+            logger(EWarn,
+                   "the Sobol sampler works best with a power of two as "
+                   "sample count (got %d)",
+                   m_samplesPerPixel);
+        }
+    }
+
+    void seed(int sampleIndex) override {
+        seed(Point2i(std::numeric_limits<int>::min()), sampleIndex);
+    }
+
+    void seed(const Point2i &pixel, int sampleIndex) override {
+        m_pixelHash     = hash::fnv1a(pixel.x(), pixel.y(), m_seed);
+        m_reversedIndex = sobol::reverseBits(uint32_t(sampleIndex));
+        m_block         = 0;
+        m_dimension     = 0;
+    }
+
+    void startBounce(int depth) override {
+        // blocks are never used twice, even if bounces are reported twice
+        const uint32_t block = uint32_t(depth) + 1;
+        if (block > m_block) {
+            m_block     = block;
+            m_dimension = 0;
+        }
+    }
+
+    float next() override {
+        const uint64_t hash = nextDimensionHash();
+        // the first Sobol dimension is the index with its bits reversed,
+        // which is reversed once more for scrambling
+        const uint32_t index = shuffledIndex(uint32_t(hash));
+        return sobol::scrambledFromReversed(index, uint32_t(hash >> 32));
+    }
+
+    Point2 next2D() override {
+        const uint64_t hash  = nextDimensionHash();
+        const uint32_t index = shuffledIndex(uint32_t(hash));
+        const uint32_t seedY = uint32_t(hash >> 32) * 0x9E3779B9 + 1;
+        return {
+            sobol::scrambledFromReversed(index, uint32_t(hash >> 32)),
+            sobol::scrambledFromReversed(
+                sobol::reversedSecondDimension(index), seedY),
+        };
+    }
+
+    ref<Sampler> clone() const override {
+        return std::make_shared<Sobol>(*this);
+    }
+
+    std::string toString() const override {
+        return tfm::format("Sobol[\n"
+                           "  count = %d\n"
+                           "]",
+                           m_samplesPerPixel);
+    }
+};
+
+} // namespace lightwave
+
+REGISTER_SAMPLER(Sobol, "sobol")
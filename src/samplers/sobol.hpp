@@ -0,0 +1,70 @@
+/**
+ * @brief Functions for generating scrambled Sobol points.
+ * @file sobol.hpp
+ */
+
+#pragma once
+
+#include <lightwave/core.hpp>
+
+namespace lightwave::sobol {
+
+inline uint32_t reverseBits(uint32_t v) {
+    v = (v << 16) | (v >> 16);
+    v = ((v & 0x00FF00FF) << 8) | ((v & 0xFF00FF00) >> 8);
+    v = ((v & 0x0F0F0F0F) << 4) | ((v & 0xF0F0F0F0) >> 4);
+    v = ((v & 0x33333333) << 2) | ((v & 0xCCCCCCCC) >> 2);
+    v = ((v & 0x55555555) << 1) | ((v & 0xAAAAAAAA) >> 1);
+    return v;
+}
+
+/// @brief Mixes the bits of a value, such that every input bit affects every
+/// output bit (the finalizer of MurmurHash3).
+inline uint64_t mixBits(uint64_t v) {
+    v ^= v >> 33;
+    v *= 0xFF51AFD7ED558CCD;
+    v ^= v >> 33;
+    v *= 0xC4CEB9FE1A85EC53;
+    v ^= v >> 33;
+    return v;
+}
+
+/**
+ * @brief Hash-based Owen scrambling of a bit-reversed value (i.e., bits only
+ * depend on less significant bits).
+ * @note See "Practical Hash-based Owen Scrambling" [Burley 2020].
+ */
+inline uint32_t laineKarrasPermutation(uint32_t v, uint32_t seed) {
+    v += seed;
+    v ^= v * 0x6C50B47C;
+    v ^= v * 0xB82F1E52;
+    v ^= v * 0xC7AFE638;
+    v ^= v * 0x8D22F6E6;
+    return v;
+}
+
+/**
+ * @brief Multiplies an index with the generator matrix of the second Sobol
+ * dimension (the Pascal matrix modulo two) and returns the 32 most significant
+ * bits of the result in reversed order, i.e., bit @c i of the result is the
+ * parity of the bits @c j of the index for which @c i is a subset of @c j .
+ * @note The first Sobol dimension is simply the index with reversed bits.
+ */
+inline uint32_t reversedSecondDimension(uint64_t index) {
+    index ^= (index >> 1) & 0x5555555555555555;
+    index ^= (index >> 2) & 0x3333333333333333;
+    index ^= (index >> 4) & 0x0F0F0F0F0F0F0F0F;
+    index ^= (index >> 8) & 0x00FF00FF00FF00FF;
+    index ^= (index >> 16) & 0x0000FFFF0000FFFF;
+    index ^= (index >> 32) & 0x00000000FFFFFFFF;
+    return uint32_t(index);
+}
+
+/// @brief Owen scrambles a Sobol value given with reversed bits, and returns
+/// it as number in [0,1).
+inline float scrambledFromReversed(uint32_t reversed, uint32_t seed) {
+    const uint32_t v = reverseBits(laineKarrasPermutation(reversed, seed));
+    return float(v >> 8) * 0x1p-24f;
+}
+
+} // namespace lightwave::sobol
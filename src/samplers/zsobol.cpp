@@ -0,0 +1,187 @@
+#include <lightwave.hpp>
+
+#include "sobol.hpp"
+
+#include <bit>
+
+namespace lightwave {
+
+/**
+ * @brief Distributes the error of neighboring pixels as blue noise, which is
+ * far less distracting than the white noise of independent samples at low
+ * sample counts (e.g., for previews) and is largely removed by denoising.
+ *
+ * All samples of the image are taken from a single Sobol sequence, in the
+ * order of a Z-curve over the pixels (i.e., the samples of 2x2 neighboring
+ * pixels are consecutive points of the sequence, and so on). The base-4
+ * digits of the sample indices are randomly permuted per dimension, so that
+ * neighboring pixels receive well-distributed but not repetitive samples.
+ * This follows Ahmed and Wonka, "Screen-Space Blue-Noise Diffusion of Monte
+ * Carlo Sampling Error via Hierarchical Ordering of Pixels" (SIGGRAPH Asia
+ * 2020), as implemented in pbrt-v4.
+ *
+ * Like the @c sobol sampler, dimensions are counted separately for the camera
+ * and each bounce of a path (see @ref Sampler::startBounce).
+ *
+ * @note The number of samples per pixel needs to be a power of two, and pixel
+ * coordinates are taken modulo 65536.
+ */
+class ZSobol : public Sampler {
+    uint64_t m_seed;
+    /// @brief The base-2 logarithm of the number of samples per pixel.
+    int m_log2SamplesPerPixel;
+    /// @brief The position of the current sample along the Z-curve, i.e., the
+    /// Morton code of the pixel followed by the sample index.
+    uint64_t m_mortonIndex;
+    /// @brief The block of dimensions that is being used, which is zero for
+    /// the camera and one plus the depth for bounces of the path.
+    uint32_t m_block;
+    /// @brief The next dimension within the current block.
+    uint32_t m_dimension;
+
+    /// @brief The number of bits of the Morton code of a pixel.
+    static constexpr int MortonBits = 32;
+
+    /// @brief Interleaves the bits of the coordinates of a pixel.
+    static uint64_t mortonCode(const Point2i &pixel) {
+        auto spread = [](uint64_t v) {
+            v &= 0xFFFF;
+            v = (v | (v << 8)) & 0x00FF00FF;
+            v = (v | (v << 4)) & 0x0F0F0F0F;
+            v = (v | (v << 2)) & 0x33333333;
+            v = (v | (v << 1)) & 0x55555555;
+            return v;
+        };
+        return spread(uint32_t(pixel.x())) |
+               (spread(uint32_t(pixel.y())) << 1);
+    }
+
+    /// @brief Returns a hash that identifies the next dimension.
+    uint64_t nextDimensionHash() {
+        return sobol::mixBits(
+            m_seed ^ ((uint64_t(m_block) << 32) | m_dimension++));
+    }
+
+    /// @brief Picks one of the 24 permutations of a base-4 digit by hashing a
+    /// value (more cheaply than @ref sobol::mixBits , as this is done for
+    /// every digit of every dimension).
+    static int permutationIndex(uint64_t v) {
+        v *= 0xD6E8FEB86659FD93;
+        v ^= v >> 32;
+        v *= 0xD6E8FEB86659FD93;
+        return int(((v >> 32) * 24) >> 32);
+    }
+
+    /**
+     * @brief Returns the index into the Sobol sequence of the current sample
+     * for a dimension, by permuting each base-4 digit of the Morton index
+     * randomly (depending on the more significant digits).
+     */
+    uint64_t sequenceIndex(uint64_t dimensionHash) const {
+        // all 24 permutations of four digits
+        static constexpr uint8_t Permutations[24][4] = {
+            { 0, 1, 2, 3 }, { 0, 1, 3, 2 }, { 0, 2, 1, 3 }, { 0, 2, 3, 1 },
+            { 0, 3, 2, 1 }, { 0, 3, 1, 2 }, { 1, 0, 2, 3 }, { 1, 0, 3, 2 },
+            { 1, 2, 0, 3 }, { 1, 2, 3, 0 }, { 1, 3, 2, 0 }, { 1, 3, 0, 2 },
+            { 2, 1, 0, 3 }, { 2, 1, 3, 0 }, { 2, 0, 1, 3 }, { 2, 0, 3, 1 },
+            { 2, 3, 0, 1 }, { 2, 3, 1, 0 }, { 3, 1, 2, 0 }, { 3, 1, 0, 2 },
+            { 3, 2, 1, 0 }, { 3, 2, 0, 1 }, { 3, 0, 2, 1 }, { 3, 0, 1, 2 },
+        };
+
+        // with an odd logarithm, the least significant digit is base 2
+        const int oddBit     = m_log2SamplesPerPixel & 1;
+        const int totalBits  = MortonBits + m_log2SamplesPerPixel;
+        const int digitCount = (totalBits + oddBit) / 2;
+
+        // the bits of samples beyond the sample count are kept as they are
+        uint64_t index = (m_mortonIndex >> totalBits) << totalBits;
+        for (int digit = digitCount - 1; digit >= oddBit; digit--) {
+            const int shift             = 2 * digit - oddBit;
+            const uint64_t higherDigits = m_mortonIndex >> (shift + 2);
+            const int permutation =
+                permutationIndex(higherDigits ^ dimensionHash);
+            const int value = (m_mortonIndex >> shift) & 3;
+            index |= uint64_t(Permutations[permutation][value]) << shift;
+        }
+        if (oddBit) {
+            const uint64_t flip =
+                sobol::mixBits((m_mortonIndex >> 1) ^ dimensionHash) & 1;
+            index |= (m_mortonIndex & 1) ^ flip;
+        }
+        return index;
+    }
+
+public:
+    ZSobol(const Properties &properties) : Sampler(properties) {
+        m_seed = properties.get<int>("seed",
+                                     std::getenv("reference") ? 1337 : 420);
+        if (!std::has_single_bit(unsigned(m_samplesPerPixel))) {
+            const int count = int(std::bit_ceil(unsigned(m_samplesPerPixel)));
+            logger(EWarn,
+                   "the zsobol sampler needs a power of two as sample count, "
+                   "using %d instead of %d",
+                   count,
+                   m_samplesPerPixel);
+            m_samplesPerPixel = count;
+        }
+        m_log2SamplesPerPixel = std::countr_zero(unsigned(m_samplesPerPixel));
+    }
+
+    void seed(int sampleIndex) override { seed(Point2i(0), sampleIndex); }
+
+    void seed(const Point2i &pixel, int sampleIndex) override {
+        const uint64_t sample = uint32_t(sampleIndex);
+        const uint64_t mask   = (uint64_t(1) << m_log2SamplesPerPixel) - 1;
+        // samples beyond the sample count (e.g., of adaptive sampling) are
+        // continued above the Morton code
+        m_mortonIndex = ((sample & ~mask) << MortonBits) |
+                        (mortonCode(pixel) << m_log2SamplesPerPixel) |
+                        (sample & mask);
+        m_block       = 0;
+        m_dimension   = 0;
+    }
+
+    void startBounce(int depth) override {
+        // blocks are never used twice, even if bounces are reported twice
+        const uint32_t block = uint32_t(depth) + 1;
+        if (block > m_block) {
+            m_block     = block;
+            m_dimension = 0;
+        }
+    }
+
+    float next() override {
+        const uint64_t hash  = nextDimensionHash();
+        const uint64_t index = sequenceIndex(hash);
+        // the first Sobol dimension is the index with its bits reversed
+        return sobol::scrambledFromReversed(uint32_t(index),
+                                            uint32_t(hash >> 32));
+    }
+
+    Point2 next2D() override {
+        const uint64_t hash  = nextDimensionHash();
+        const uint64_t index = sequenceIndex(hash);
+        const uint32_t seedY = uint32_t(hash >> 32) * 0x9E3779B9 + 1;
+        return {
+            sobol::scrambledFromReversed(uint32_t(index),
+                                         uint32_t(hash >> 32)),
+            sobol::scrambledFromReversed(
+                sobol::reversedSecondDimension(index), seedY),
+        };
+    }
+
+    ref<Sampler> clone() const override {
+        return std::make_shared<ZSobol>(*this);
+    }
+
+    std::string toString() const override {
+        return tfm::format("ZSobol[\n"
+                           "  count = %d\n"
+                           "]",
+                           m_samplesPerPixel);
+    }
+};
+
+} // namespace lightwave
+
+REGISTER_SAMPLER(ZSobol, "zsobol")
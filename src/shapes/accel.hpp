@@ -1,11 +1,24 @@
 #pragma once
 
 #include <lightwave/core.hpp>
+#include <lightwave/hash.hpp>
+#include <lightwave/iterators.hpp>
 #include <lightwave/math.hpp>
+#include <lightwave/parallel.hpp>
 #include <lightwave/shape.hpp>
 
+#include <atomic>
+#include <bit>
 #include <numeric>
 
+#ifdef LW_CC_MSC
+#include <xmmintrin.h>
+#endif
+
+#ifdef LW_SIMD_SSE
+#include <immintrin.h>
+#endif
+
 namespace lightwave {
 
 /**
@@ -23,6 +36,17 @@ namespace lightwave {
  * - getCentroid(primitiveIndex)    -- return the centroid of a single child
  * (used for building the BVH)
  *
+ * Shapes that can test several children at once can additionally override
+ * intersectLeaf(...) and occludedLeaf(...).
+ *
+ * The binary BVH can optionally be collapsed into a 4-wide or 8-wide BVH,
+ * which tests the bounding boxes of all children of a node at once using SIMD
+ * instructions. This is selected using the @c accel attribute of the shape
+ * ( @c "bvh2" , @c "bvh4" or @c "bvh8" ), e.g.,
+ * @code <shape type="mesh" accel="bvh8"/> @endcode
+ * For the implicit group of all shapes of a scene, the attribute can be given
+ * on the @c scene tag instead.
+ *
  * @example For a simple example of how to use this class, look at @ref
  * shapes/group.cpp
  * @see Group
@@ -33,8 +57,18 @@ class AccelerationStructure : public Shape {
     /// remapping.
     typedef int32_t NodeIndex;
 
-    /// @brief A node in our binary BVH tree.
-    struct Node {
+    /**
+     * @brief The maximum depth of the BVH tree. Nodes at this depth will not be
+     * subdivided further, which allows traversal to use a fixed-size stack.
+     */
+    static constexpr int MaxDepth = 64;
+
+    /**
+     * @brief A node in our binary BVH tree.
+     * @note Nodes are exactly 32 bytes large and aligned to 32 bytes, so that a
+     * node never straddles two cache lines.
+     */
+    struct alignas(32) Node {
         /// @brief The axis aligned bounding box of this node.
         Bounds aabb;
         /**
@@ -70,14 +104,139 @@ class AccelerationStructure : public Shape {
             return leftFirst + primitiveCount - 1;
         }
     };
+    static_assert(sizeof(Node) == 32, "BVH nodes must be 32 bytes large");
+
+    /**
+     * @brief Ray data that is precomputed once per traversal, so that slab
+     * tests require neither divisions nor branches on the ray direction.
+     */
+    struct TraversalRay {
+        /// @brief The origin of the ray.
+        Point origin;
+        /// @brief The componentwise reciprocal of the ray direction.
+        Vector invDirection;
+        /// @brief For each axis, whether the ray direction is negative (i.e.,
+        /// whether the maximum slab is hit before the minimum slab).
+        std::array<bool, 3> isNegative;
+
+        TraversalRay(const Ray &ray) : origin(ray.origin) {
+            for (int axis = 0; axis < 3; axis++) {
+                invDirection[axis] = 1 / ray.direction[axis];
+                isNegative[axis]   = invDirection[axis] < 0;
+            }
+        }
+    };
+
+    /// @brief An entry on the traversal stack, which remembers the distance to
+    /// the node's bounding box so that it does not need to be tested again.
+    struct StackEntry {
+        NodeIndex nodeIndex;
+        float tNear;
+    };
+
+    /**
+     * @brief A node of a wide BVH, which stores the bounding boxes of all of
+     * its children in structure of arrays layout so that they can be tested
+     * against a ray with a single SIMD slab test.
+     * @note Unused child slots have empty (inverted) bounding boxes, which are
+     * never hit by any ray.
+     */
+    template <int Width> struct alignas(32) WideNode {
+        /// @brief The bounding boxes of the children, indexed by minimum (0)
+        /// or maximum (1), axis and child.
+        float bounds[2][3][Width];
+        /// @brief Either the index of the child node (for internal children),
+        /// or the first index in m_primitiveIndices (for leaf children).
+        NodeIndex children[Width];
+        /// @brief The number of primitives of leaf children, or 0 for internal
+        /// children.
+        NodeIndex primitiveCounts[Width];
+    };
+
+    /// @brief An entry on the traversal stack of a wide BVH, which can refer
+    /// to either an internal node or a leaf.
+    struct WideStackEntry {
+        NodeIndex index;
+        NodeIndex primitiveCount;
+        float tNear;
+    };
+
+    /// @brief Subtrees with at most this many primitives become leaves of a
+    /// wide BVH.
+    static constexpr NodeIndex WideLeafSize = 4;
+
+    /// @brief The number of bins used to evaluate the surface area heuristic.
+    static constexpr int BinCount = 16;
+    /// @brief Nodes with at least this many primitives are binned in parallel,
+    /// smaller nodes are built as independent subtrees in parallel instead.
+    static constexpr NodeIndex ParallelThreshold = 16384;
+    /// @brief The number of primitives processed by each parallel work item.
+    static constexpr int ChunkSize = 4096;
 
     struct Bin {
         Bounds aabb;
         int primitiveCount = 0;
     };
 
-    /// @brief A list of all BVH nodes.
+    /// @brief The bins of all three axes, which are filled in a single pass
+    /// over the primitives of a node.
+    struct Binning {
+        Bin bins[3][BinCount];
+
+        /// @brief Merges the bins of another (partial) binning into this one.
+        void extend(const Binning &other) {
+            for (int axis = 0; axis < 3; axis++) {
+                for (int bin = 0; bin < BinCount; bin++) {
+                    bins[axis][bin].aabb.extend(other.bins[axis][bin].aabb);
+                    bins[axis][bin].primitiveCount +=
+                        other.bins[axis][bin].primitiveCount;
+                }
+            }
+        }
+    };
+
+    /**
+     * @brief State shared by all build tasks. The bounding boxes and centroids
+     * of all primitives are computed once before building, and are stored as
+     * structure of arrays (indexed by primitive index) so that binning neither
+     * needs virtual calls nor copies of the underlying primitives.
+     */
+    struct BuildContext {
+        std::array<std::vector<float>, 3> centroids;
+        std::array<std::vector<float>, 3> boundsMin;
+        std::array<std::vector<float>, 3> boundsMax;
+        /// @brief The number of nodes allocated in m_nodes so far.
+        std::atomic<NodeIndex> nodeCount;
+
+        Point centroid(int primitiveIndex) const {
+            return { centroids[0][primitiveIndex],
+                     centroids[1][primitiveIndex],
+                     centroids[2][primitiveIndex] };
+        }
+
+        Bounds bounds(int primitiveIndex) const {
+            return { { boundsMin[0][primitiveIndex],
+                       boundsMin[1][primitiveIndex],
+                       boundsMin[2][primitiveIndex] },
+                     { boundsMax[0][primitiveIndex],
+                       boundsMax[1][primitiveIndex],
+                       boundsMax[2][primitiveIndex] } };
+        }
+    };
+
+    /// @brief The branching factor of the BVH that is used for traversal (2,
+    /// 4 or 8).
+    int m_width = 2;
+    /**
+     * @brief A list of all BVH nodes.
+     * @note If a wide BVH is used, only the root node is retained after
+     * building, to answer bounding box queries.
+     */
     std::vector<Node> m_nodes;
+    /// @brief The nodes of the 4-wide BVH (if used), with the root first.
+    std::vector<WideNode<4>> m_nodes4;
+    /// @brief The nodes of the 8-wide BVH (if used), with the root first.
+    std::vector<WideNode<8>> m_nodes8;
     /**
      * @brief Mapping from internal @c NodeIndex to @c primitiveIndex as used by
      * all interface methods. For efficient storage, we assume that children of
@@ -95,69 +254,366 @@ class AccelerationStructure : public Shape {
         return m_nodes.front();
     }
 
+    template <int Width> std::vector<WideNode<Width>> &wideNodes() {
+        if constexpr (Width == 4)
+            return m_nodes4;
+        else
+            return m_nodes8;
+    }
+
+    template <int Width>
+    const std::vector<WideNode<Width>> &wideNodes() const {
+        if constexpr (Width == 4)
+            return m_nodes4;
+        else
+            return m_nodes8;
+    }
+
+    /// @brief Hints the CPU to load the given node into cache, as it will
+    /// likely be needed soon.
+    template <typename T> static void prefetch(const T &node) {
+#if defined(LW_CC_GNU) || defined(LW_CC_CLANG)
+        __builtin_prefetch(&node);
+#elif defined(LW_CC_MSC)
+        _mm_prefetch(reinterpret_cast<const char *>(&node), _MM_HINT_T0);
+#endif
+    }
+
     /**
-     * @brief Intersects a BVH node, recursing into children (for internal
-     * nodes), or intersecting all primitives (for leaf nodes).
+     * @brief Traverses the BVH using an explicit stack, intersecting all
+     * primitives of the leaf nodes that are encountered.
+     * Children are visited front to back, and the far child is only pushed
+     * onto the stack (together with its entry distance) if it could still
+     * contain a closer intersection.
      */
-    bool intersectNode(const Node &node, const Ray &ray, Intersection &its,
-                       Sampler &rng) const {
-        // update the statistic tracking how many BVH nodes have been tested for
-        // intersection
-        its.stats.bvhCounter++;
+    bool intersectNodes(const Ray &ray, Intersection &its,
+                        Sampler &rng) const {
+        const TraversalRay traversalRay{ ray };
+        if (!(intersectAABB(rootNode().aabb, traversalRay) < its.t))
+            return false;
+
+        StackEntry stack[MaxDepth];
+        int stackSize = 0;
 
         bool wasIntersected = false;
-        if (node.isLeaf()) {
-            for (NodeIndex i = 0; i < node.primitiveCount; i++) {
-                // update the statistic tracking how many children have been
-                // tested for intersection
-                its.stats.primCounter++;
-                // test the child for intersection
-                wasIntersected |= intersect(
-                    m_primitiveIndices[node.leftFirst + i], ray, its, rng);
+        NodeIndex nodeIndex = 0;
+        while (true) {
+            const Node &node = m_nodes[nodeIndex];
+            // update the statistic tracking how many BVH nodes have been
+            // tested for intersection
+            its.stats.bvhCounter++;
+
+            if (node.isLeaf()) {
+                wasIntersected |= intersectLeaf(
+                    node.firstPrimitiveIndex(), node.primitiveCount, ray, its,
+                    rng);
+            } else { // internal node
+                // test which bounding box is intersected first by the ray.
+                // this allows us to traverse the children in the order they
+                // are intersected in, which can help prune a lot of
+                // unnecessary intersection tests.
+                NodeIndex nearIndex = node.leftChildIndex();
+                NodeIndex farIndex  = node.rightChildIndex();
+                float nearT =
+                    intersectAABB(m_nodes[nearIndex].aabb, traversalRay);
+                float farT =
+                    intersectAABB(m_nodes[farIndex].aabb, traversalRay);
+                if (farT < nearT) {
+                    std::swap(nearIndex, farIndex);
+                    std::swap(nearT, farT);
+                }
+
+                if (farT < its.t) {
+                    // the far child will be visited later, so start loading
+                    // its children while we process the near child
+                    const Node &farNode = m_nodes[farIndex];
+                    if (!farNode.isLeaf())
+                        prefetch(m_nodes[farNode.leftChildIndex()]);
+                    stack[stackSize++] = { farIndex, farT };
+                }
+                if (nearT < its.t) {
+                    nodeIndex = nearIndex;
+                    continue;
+                }
+            }
+
+            // pop the next node that could still contain a closer
+            // intersection
+            do {
+                if (stackSize == 0)
+                    return wasIntersected;
+                const StackEntry &entry = stack[--stackSize];
+                nodeIndex               = entry.nodeIndex;
+                if (entry.tNear < its.t)
+                    break;
+            } while (true);
+        }
+    }
+
+    /**
+     * @brief Traverses the BVH until any primitive is found that intersects
+     * the ray closer than @c tMax . As any intersection suffices, children
+     * are not sorted by distance.
+     */
+    bool occludedNodes(const Ray &ray, float tMax, Sampler &rng) const {
+        const TraversalRay traversalRay{ ray };
+        if (!(intersectAABB(rootNode().aabb, traversalRay) < tMax))
+            return false;
+
+        NodeIndex stack[MaxDepth];
+        int stackSize = 0;
+
+        NodeIndex nodeIndex = 0;
+        while (true) {
+            const Node &node = m_nodes[nodeIndex];
+            if (node.isLeaf()) {
+                if (occludedLeaf(node.firstPrimitiveIndex(),
+                                 node.primitiveCount,
+                                 ray,
+                                 tMax,
+                                 rng))
+                    return true;
+            } else { // internal node
+                const NodeIndex leftIndex  = node.leftChildIndex();
+                const NodeIndex rightIndex = node.rightChildIndex();
+                const bool hitsLeft =
+                    intersectAABB(m_nodes[leftIndex].aabb, traversalRay) < tMax;
+                const bool hitsRight =
+                    intersectAABB(m_nodes[rightIndex].aabb, traversalRay) <
+                    tMax;
+
+                if (hitsLeft && hitsRight) {
+                    stack[stackSize++] = rightIndex;
+                    nodeIndex          = leftIndex;
+                    continue;
+                }
+                if (hitsLeft || hitsRight) {
+                    nodeIndex = hitsLeft ? leftIndex : rightIndex;
+                    continue;
+                }
             }
-        } else { // internal node
-            // test which bounding box is intersected first by the ray.
-            // this allows us to traverse the children in the order they are
-            // intersected in, which can help prune a lot of unnecessary
-            // intersection tests.
-            const auto leftT =
-                intersectAABB(m_nodes[node.leftChildIndex()].aabb, ray);
-            const auto rightT =
-                intersectAABB(m_nodes[node.rightChildIndex()].aabb, ray);
-            if (leftT < rightT) { // left child is hit first; test left child
-                                  // first, then right child
-                if (leftT < its.t)
-                    wasIntersected |= intersectNode(
-                        m_nodes[node.leftChildIndex()], ray, its, rng);
-                if (rightT < its.t)
-                    wasIntersected |= intersectNode(
-                        m_nodes[node.rightChildIndex()], ray, its, rng);
-            } else { // right child is hit first; test right child first, then
-                     // left child
-                if (rightT < its.t)
-                    wasIntersected |= intersectNode(
-                        m_nodes[node.rightChildIndex()], ray, its, rng);
-                if (leftT < its.t)
-                    wasIntersected |= intersectNode(
-                        m_nodes[node.leftChildIndex()], ray, its, rng);
+
+            if (stackSize == 0)
+                return false;
+            nodeIndex = stack[--stackSize];
+        }
+    }
+
+    /**
+     * @brief Traverses a wide BVH using an explicit stack. All children of a
+     * node are tested at once, and the children that are hit are visited
+     * front to back.
+     */
+    template <int Width>
+    bool intersectWideNodes(const Ray &ray, Intersection &its,
+                            Sampler &rng) const {
+        const std::vector<WideNode<Width>> &nodes = wideNodes<Width>();
+        const TraversalRay traversalRay{ ray };
+
+        WideStackEntry stack[MaxDepth * Width];
+        int stackSize = 0;
+
+        bool wasIntersected   = false;
+        WideStackEntry entry = { 0, 0, -Infinity };
+        while (true) {
+            if (entry.primitiveCount) {
+                wasIntersected |= intersectLeaf(
+                    entry.index, entry.primitiveCount, ray, its, rng);
+            } else { // internal node
+                const WideNode<Width> &node = nodes[entry.index];
+                its.stats.bvhCounter++;
+
+                float tNear[Width];
+                int hitMask =
+                    intersectChildren<Width>(node, traversalRay, its.t, tNear);
+
+                // sort the children that were hit by distance (insertion sort
+                // is fast for so few elements)
+                WideStackEntry hits[Width];
+                int hitCount = 0;
+                for (; hitMask; hitMask &= hitMask - 1) {
+                    const int child = std::countr_zero(unsigned(hitMask));
+                    WideStackEntry hit = { node.children[child],
+                                           node.primitiveCounts[child],
+                                           tNear[child] };
+                    int i = hitCount++;
+                    for (; i > 0 && hits[i - 1].tNear < hit.tNear; i--)
+                        hits[i] = hits[i - 1];
+                    hits[i] = hit;
+                }
+
+                if (hitCount > 0) {
+                    // push all but the nearest child far to near, and
+                    // continue with the nearest child right away
+                    for (int i = 0; i < hitCount - 1; i++) {
+                        if (!hits[i].primitiveCount)
+                            prefetch(nodes[hits[i].index]);
+                        stack[stackSize++] = hits[i];
+                    }
+                    entry = hits[hitCount - 1];
+                    continue;
+                }
             }
+
+            // pop the next node that could still contain a closer
+            // intersection
+            do {
+                if (stackSize == 0)
+                    return wasIntersected;
+                entry = stack[--stackSize];
+            } while (!(entry.tNear < its.t));
         }
-        return wasIntersected;
+    }
+
+    /// @brief Traverses a wide BVH until any primitive is found that
+    /// intersects the ray closer than @c tMax .
+    template <int Width>
+    bool occludedWideNodes(const Ray &ray, float tMax, Sampler &rng) const {
+        const std::vector<WideNode<Width>> &nodes = wideNodes<Width>();
+        const TraversalRay traversalRay{ ray };
+
+        WideStackEntry stack[MaxDepth * Width];
+        int stackSize = 0;
+
+        WideStackEntry entry = { 0, 0, -Infinity };
+        while (true) {
+            if (entry.primitiveCount) {
+                if (occludedLeaf(
+                        entry.index, entry.primitiveCount, ray, tMax, rng))
+                    return true;
+            } else { // internal node
+                const WideNode<Width> &node = nodes[entry.index];
+
+                float tNear[Width];
+                int hitMask =
+                    intersectChildren<Width>(node, traversalRay, tMax, tNear);
+                for (; hitMask; hitMask &= hitMask - 1) {
+                    const int child    = std::countr_zero(unsigned(hitMask));
+                    stack[stackSize++] = { node.children[child],
+                                           node.primitiveCounts[child],
+                                           tNear[child] };
+                }
+            }
+
+            if (stackSize == 0)
+                return false;
+            entry = stack[--stackSize];
+        }
+    }
+
+    /**
+     * @brief Performs a slab test of all children of a wide BVH node at once.
+     * @param tMax Only bounding boxes entered before this distance are
+     * reported.
+     * @param tNear Receives the distances at which the bounding boxes are
+     * entered (may be negative).
+     * @return A bit mask of the children whose bounding boxes are hit.
+     */
+    template <int Width>
+    static int intersectChildren(const WideNode<Width> &node,
+                                 const TraversalRay &ray, float tMax,
+                                 float tNear[Width]) {
+#ifdef LW_SIMD_SSE
+#ifdef LW_SIMD_AVX
+        if constexpr (Width == 8) {
+            __m256 nearT = _mm256_set1_ps(-Infinity);
+            __m256 farT  = _mm256_set1_ps(+Infinity);
+            for (int axis = 0; axis < 3; axis++) {
+                const bool isNegative = ray.isNegative[axis];
+                const __m256 origin   = _mm256_set1_ps(ray.origin[axis]);
+                const __m256 invDir   = _mm256_set1_ps(ray.invDirection[axis]);
+                const __m256 nearSlab =
+                    _mm256_load_ps(node.bounds[isNegative][axis]);
+                const __m256 farSlab =
+                    _mm256_load_ps(node.bounds[!isNegative][axis]);
+                // the running extremum is the second operand, so that NaNs
+                // (from rays parallel to a slab) are ignored
+                nearT = _mm256_max_ps(
+                    _mm256_mul_ps(_mm256_sub_ps(nearSlab, origin), invDir),
+                    nearT);
+                farT = _mm256_min_ps(
+                    _mm256_mul_ps(_mm256_sub_ps(farSlab, origin), invDir),
+                    farT);
+            }
+            _mm256_storeu_ps(tNear, nearT);
+            const __m256 hit = _mm256_and_ps(
+                _mm256_and_ps(_mm256_cmp_ps(nearT, farT, _CMP_LE_OQ),
+                              _mm256_cmp_ps(farT,
+                                            _mm256_set1_ps(Epsilon),
+                                            _CMP_GE_OQ)),
+                _mm256_cmp_ps(nearT, _mm256_set1_ps(tMax), _CMP_LT_OQ));
+            return _mm256_movemask_ps(hit);
+        }
+#endif
+        // process the children in groups of four
+        int hitMask = 0;
+        for (int group = 0; group < Width; group += 4) {
+            __m128 nearT = _mm_set1_ps(-Infinity);
+            __m128 farT  = _mm_set1_ps(+Infinity);
+            for (int axis = 0; axis < 3; axis++) {
+                const bool isNegative = ray.isNegative[axis];
+                const __m128 origin   = _mm_set1_ps(ray.origin[axis]);
+                const __m128 invDir   = _mm_set1_ps(ray.invDirection[axis]);
+                const __m128 nearSlab =
+                    _mm_load_ps(node.bounds[isNegative][axis] + group);
+                const __m128 farSlab =
+                    _mm_load_ps(node.bounds[!isNegative][axis] + group);
+                // the running extremum is the second operand, so that NaNs
+                // (from rays parallel to a slab) are ignored
+                nearT = _mm_max_ps(
+                    _mm_mul_ps(_mm_sub_ps(nearSlab, origin), invDir), nearT);
+                farT = _mm_min_ps(
+                    _mm_mul_ps(_mm_sub_ps(farSlab, origin), invDir), farT);
+            }
+            _mm_storeu_ps(tNear + group, nearT);
+            const __m128 hit = _mm_and_ps(
+                _mm_and_ps(_mm_cmple_ps(nearT, farT),
+                           _mm_cmpge_ps(farT, _mm_set1_ps(Epsilon))),
+                _mm_cmplt_ps(nearT, _mm_set1_ps(tMax)));
+            hitMask |= _mm_movemask_ps(hit) << group;
+        }
+        return hitMask;
+#else
+        int hitMask = 0;
+        for (int child = 0; child < Width; child++) {
+            float nearT = -Infinity;
+            float farT  = +Infinity;
+            for (int axis = 0; axis < 3; axis++) {
+                const bool isNegative = ray.isNegative[axis];
+                const float nearSlab  = node.bounds[isNegative][axis][child];
+                const float farSlab   = node.bounds[!isNegative][axis][child];
+                nearT = max(nearT,
+                            (nearSlab - ray.origin[axis]) *
+                                ray.invDirection[axis]);
+                farT  = min(farT,
+                           (farSlab - ray.origin[axis]) *
+                               ray.invDirection[axis]);
+            }
+            tNear[child] = nearT;
+            if (nearT <= farT && farT >= Epsilon && nearT < tMax)
+                hitMask |= 1 << child;
+        }
+        return hitMask;
+#endif
     }
 
     /// @brief Performs a slab test to intersect a bounding box with a ray,
     /// returning Infinity in case the ray misses.
-    float intersectAABB(const Bounds &bounds, const Ray &ray) const {
-        const auto t1 = (bounds.min() - ray.origin) / ray.direction;
-        // intersect all axes at once with the maximum slabs of the bounding box
-        const auto t2 = (bounds.max() - ray.origin) / ray.direction;
-
-        // the elementwiseMin picks the near slab for each axis, of which we
-        // then take the maximum
-        const auto tNear = elementwiseMin(t1, t2).maxComponent();
-        // the elementwiseMax picks the far slab for each axis, of which we then
-        // take the minimum
-        const auto tFar = elementwiseMax(t1, t2).minComponent();
+    float intersectAABB(const Bounds &bounds, const TraversalRay &ray) const {
+        float tNear = -Infinity;
+        float tFar  = +Infinity;
+        for (int axis = 0; axis < 3; axis++) {
+            // the sign of the direction tells us which slab is hit first, so
+            // we do not need to sort the two distances
+            const float nearSlab = ray.isNegative[axis] ? bounds.max()[axis]
+                                                        : bounds.min()[axis];
+            const float farSlab  = ray.isNegative[axis] ? bounds.min()[axis]
+                                                        : bounds.max()[axis];
+            tNear = max(tNear,
+                        (nearSlab - ray.origin[axis]) * ray.invDirection[axis]);
+            tFar  = min(tFar,
+                       (farSlab - ray.origin[axis]) * ray.invDirection[axis]);
+        }
 
         if (tFar < tNear)
             return Infinity; // the ray does not intersect the bounding box
@@ -168,14 +624,42 @@ class AccelerationStructure : public Shape {
                       // (may also be negative!)
     }
 
-    /// @brief Computes the axis aligned bounding box for a leaf BVH node
-    void computeAABB(Node &node) {
-        node.aabb = Bounds::empty();
-        for (NodeIndex i = 0; i < node.primitiveCount; i++) {
-            const Bounds childAABB =
-                getBoundingBox(m_primitiveIndices[node.leftFirst + i]);
-            node.aabb.extend(childAABB);
+    /**
+     * @brief Invokes @c f for all primitives of a node to accumulate a value
+     * of type @c T . Large nodes are processed in parallel, in which case the
+     * partial results of each chunk are merged using @c T::extend .
+     */
+    template <typename T, typename F>
+    T reducePrimitives(const Node &node, F f) const {
+        T result;
+        if (node.primitiveCount < ParallelThreshold) {
+            for (NodeIndex i = 0; i < node.primitiveCount; i++)
+                f(result, m_primitiveIndices[node.leftFirst + i]);
+            return result;
         }
+
+        std::mutex mutex;
+        for_each_parallel(
+            ChunkedRange(node.firstPrimitiveIndex(),
+                         node.lastPrimitiveIndex() + 1,
+                         ChunkSize),
+            [&](const Range &range) {
+                T partial;
+                for (int i : range)
+                    f(partial, m_primitiveIndices[i]);
+
+                std::unique_lock lock{ mutex };
+                result.extend(partial);
+            });
+        return result;
+    }
+
+    /// @brief Computes the axis aligned bounding box for a leaf BVH node
+    void computeAABB(const BuildContext &ctx, Node &node) {
+        node.aabb = reducePrimitives<Bounds>(
+            node, [&](Bounds &aabb, int primitiveIndex) {
+                aabb.extend(ctx.bounds(primitiveIndex));
+            });
     }
 
     /// @brief Computes the surface area of a bounding box.
@@ -195,74 +679,86 @@ class AccelerationStructure : public Shape {
      * useful split exists
      */
     // Variable notations taken from https://jacco.ompf2.com/2022/04/21/how-to-build-a-bvh-part-3-quick-builds/
-    void binning(const Node &node, int &bestSplitAxis,
+    void binning(const BuildContext &ctx, const Node &node, int &bestSplitAxis,
                  float &bestSplitPosition) {
-        // NOT_IMPLEMENTED
+        bestSplitAxis  = -1;
         float bestCost = Infinity;
-        const int BINS = 16;
-        int startAxis, endAxis;
-        Point centroid;
-        Bounds bounds;
-        if (bestSplitAxis == -1){
-            startAxis = 0;
-            endAxis = 3;
-        }
-        else{
-            startAxis = bestSplitAxis;
-            endAxis = bestSplitAxis + 1;
-        }
-        for (int a = startAxis; a < endAxis; a++){
-            float boundsMin = Infinity, boundsMax = -Infinity;
-            for (int i = 0; i < node.primitiveCount; i++){
-                centroid = getCentroid(m_primitiveIndices[node.leftFirst + i]);
-                boundsMin = min(boundsMin, centroid[a]);
-                boundsMax = max(boundsMax, centroid[a]);
-            }
-            if(boundsMin == boundsMax) continue;
-
-            Bin bins[BINS];
-            float scale = BINS / (boundsMax - boundsMin);
-            for(NodeIndex i = 0; i < node.primitiveCount; i++){
-                centroid = getCentroid(m_primitiveIndices[node.leftFirst + i]);
-                bounds = getBoundingBox(m_primitiveIndices[node.leftFirst + i]);
-                int binIdx = min(BINS - 1, (int)((centroid[a] - boundsMin) * scale));
-                bins[binIdx].primitiveCount++;
-                bins[binIdx].aabb.extend(bounds);
-            }
 
-            float leftArea[BINS - 1], rightArea[BINS - 1];
-            float leftCount[BINS - 1], rightCount[BINS - 1];
+        // the bins span the bounds of the centroids (not of the primitives)
+        const Bounds centroidBounds = reducePrimitives<Bounds>(
+            node, [&](Bounds &bounds, int primitiveIndex) {
+                bounds.extend(ctx.centroid(primitiveIndex));
+            });
+        const Point boundsMin = centroidBounds.min();
+        const Point boundsMax = centroidBounds.max();
+
+        Vector scale;
+        for (int a = 0; a < 3; a++)
+            scale[a] = BinCount / (boundsMax[a] - boundsMin[a]);
+
+        // fill the bins of all axes in a single pass over the primitives
+        const Binning binning = reducePrimitives<Binning>(
+            node, [&](Binning &binning, int primitiveIndex) {
+                const Bounds bounds = ctx.bounds(primitiveIndex);
+                for (int a = 0; a < 3; a++) {
+                    if (boundsMin[a] == boundsMax[a])
+                        continue;
+                    const int binIdx = min(
+                        BinCount - 1,
+                        (int) ((ctx.centroids[a][primitiveIndex] -
+                                boundsMin[a]) *
+                               scale[a]));
+                    binning.bins[a][binIdx].primitiveCount++;
+                    binning.bins[a][binIdx].aabb.extend(bounds);
+                }
+            });
+
+        for (int a = 0; a < 3; a++) {
+            if (boundsMin[a] == boundsMax[a])
+                continue;
+
+            const Bin *bins = binning.bins[a];
+            float leftArea[BinCount - 1], rightArea[BinCount - 1];
+            float leftCount[BinCount - 1], rightCount[BinCount - 1];
             Bounds leftBox, rightBox;
             int leftSum = 0, rightSum = 0;
-            
-            for(int i = 0; i < BINS - 1; i++){
+
+            for (int i = 0; i < BinCount - 1; i++) {
                 leftSum += bins[i].primitiveCount;
                 leftCount[i] = leftSum;
                 leftBox.extend(bins[i].aabb);
                 leftArea[i] = surfaceArea(leftBox);
-                rightSum += bins[BINS - 1 - i].primitiveCount;
-                rightCount[BINS - 2 - i] = rightSum;
-                rightBox.extend(bins[BINS - 1 - i].aabb);
-                rightArea[BINS - 2 - i] = surfaceArea(rightBox);
+                rightSum += bins[BinCount - 1 - i].primitiveCount;
+                rightCount[BinCount - 2 - i] = rightSum;
+                rightBox.extend(bins[BinCount - 1 - i].aabb);
+                rightArea[BinCount - 2 - i] = surfaceArea(rightBox);
             }
-            scale = (boundsMax - boundsMin) / BINS;
-
-            for(int i = 0; i < BINS - 1; i++){
-                float planeCost = leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i];
-                if (planeCost < bestCost){
-                    bestSplitAxis = a;
-                    bestSplitPosition = boundsMin + scale * (i + 1);
-                    bestCost = planeCost;
+            const float binWidth = (boundsMax[a] - boundsMin[a]) / BinCount;
+
+            for (int i = 0; i < BinCount - 1; i++) {
+                float planeCost = leftCount[i] * leftArea[i] +
+                                  rightCount[i] * rightArea[i];
+                if (planeCost < bestCost) {
+                    bestSplitAxis     = a;
+                    bestSplitPosition = boundsMin[a] + binWidth * (i + 1);
+                    bestCost          = planeCost;
                 }
             }
         }
     }
 
-    /// @brief Attempts to subdivide a given BVH node.
-    void subdivide(Node &parent) {
-        // only subdivide if enough children are available.
-        if (parent.primitiveCount <= 2) {
-            return;
+    /**
+     * @brief Attempts to split a given BVH node into two children.
+     * @return Whether the node has been split. If so, the node has become an
+     * internal node whose children have their bounding boxes computed, but
+     * have not been subdivided any further.
+     */
+    bool split(BuildContext &ctx, NodeIndex parentIndex, int depth) {
+        Node &parent = m_nodes[parentIndex];
+        // only subdivide if enough children are available, and if the
+        // traversal stack can still accomodate the children.
+        if (parent.primitiveCount <= 2 || depth >= MaxDepth) {
+            return false;
         }
 
         // set to true when implementing binning
@@ -272,7 +768,7 @@ class AccelerationStructure : public Shape {
         float splitPosition;
         if (UseSAH) {
             // pick split axis and position using binned SAH
-            binning(parent, splitAxis, splitPosition);
+            binning(ctx, parent, splitAxis, splitPosition);
         } else {
             // split in the middle of the longest axis
             splitAxis     = parent.aabb.diagonal().maxComponentIndex();
@@ -281,7 +777,7 @@ class AccelerationStructure : public Shape {
 
         if (splitAxis == -1) {
             // a split axis of -1 indicates that no useful split exists
-            return;
+            return false;
         }
 
         // the point at which to split (note that primitives must be re-ordered
@@ -290,10 +786,11 @@ class AccelerationStructure : public Shape {
         // equal to firstRightIndex)
         NodeIndex firstRightIndex = parent.firstPrimitiveIndex();
         NodeIndex lastLeftIndex   = parent.lastPrimitiveIndex();
+        const std::vector<float> &centroids = ctx.centroids[splitAxis];
 
         // partition algorithm (you might remember this from quicksort)
         while (firstRightIndex <= lastLeftIndex) {
-            if (getCentroid(m_primitiveIndices[firstRightIndex])[splitAxis] <
+            if (centroids[m_primitiveIndices[firstRightIndex]] <
                 splitPosition) {
                 firstRightIndex++;
             } else {
@@ -308,32 +805,149 @@ class AccelerationStructure : public Shape {
 
         if (leftCount == 0 || rightCount == 0) {
             // if either child gets no primitives, we abort subdividing
-            return;
+            return false;
         }
 
         // the two children will always be contiguous in our m_nodes list
-        const NodeIndex leftChildIndex  = (NodeIndex) (m_nodes.size() + 0);
-        const NodeIndex rightChildIndex = (NodeIndex) (m_nodes.size() + 1);
+        const NodeIndex leftChildIndex  = ctx.nodeCount.fetch_add(2);
+        const NodeIndex rightChildIndex = leftChildIndex + 1;
         parent.primitiveCount = 0; // mark the parent node as internal node
         parent.leftFirst      = leftChildIndex;
 
-        m_nodes.emplace_back();
         m_nodes[leftChildIndex].leftFirst      = firstLeftIndex;
         m_nodes[leftChildIndex].primitiveCount = leftCount;
+        computeAABB(ctx, m_nodes[leftChildIndex]);
 
-        m_nodes.emplace_back();
         m_nodes[rightChildIndex].leftFirst      = firstRightIndex;
         m_nodes[rightChildIndex].primitiveCount = rightCount;
+        computeAABB(ctx, m_nodes[rightChildIndex]);
+        return true;
+    }
 
+    /// @brief Recursively subdivides a given BVH node.
+    void subdivide(BuildContext &ctx, NodeIndex parentIndex, int depth) {
+        if (!split(ctx, parentIndex, depth))
+            return;
+
+        const Node &parent = m_nodes[parentIndex];
         // first, process the left child node (and all of its children)
-        computeAABB(m_nodes[leftChildIndex]);
-        subdivide(m_nodes[leftChildIndex]);
+        subdivide(ctx, parent.leftChildIndex(), depth + 1);
         // then, process the right child node (and all of its children)
-        computeAABB(m_nodes[rightChildIndex]);
-        subdivide(m_nodes[rightChildIndex]);
+        subdivide(ctx, parent.rightChildIndex(), depth + 1);
+    }
+
+    /// @brief The contiguous range of m_primitiveIndices that is covered by
+    /// the subtree of a binary BVH node.
+    struct PrimitiveRange {
+        NodeIndex first;
+        NodeIndex count;
+    };
+
+    /**
+     * @brief Converts the subtree of a binary BVH node into wide BVH nodes.
+     * The children of the wide node are found by repeatedly replacing the
+     * internal child with the largest surface area by its two children.
+     * Subtrees with at most @c WideLeafSize primitives become leaves, as
+     * testing their primitives directly is cheaper than visiting another
+     * (sparsely populated) wide node.
+     * @return The index of the created wide node.
+     */
+    template <int Width>
+    NodeIndex collapse(const std::vector<PrimitiveRange> &ranges,
+                       NodeIndex binaryIndex) {
+        std::vector<WideNode<Width>> &nodes = wideNodes<Width>();
+        auto becomesLeaf = [&](NodeIndex index) {
+            return m_nodes[index].isLeaf() ||
+                   ranges[index].count <= WideLeafSize;
+        };
+
+        NodeIndex children[Width] = { binaryIndex };
+        int childCount            = 1;
+        while (childCount < Width) {
+            int largest       = -1;
+            float largestArea = -Infinity;
+            for (int i = 0; i < childCount; i++) {
+                if (becomesLeaf(children[i]))
+                    continue;
+                const float area = surfaceArea(m_nodes[children[i]].aabb);
+                if (area > largestArea) {
+                    largest     = i;
+                    largestArea = area;
+                }
+            }
+            if (largest == -1)
+                break; // only leaves are left
+
+            const Node &opened     = m_nodes[children[largest]];
+            children[largest]      = opened.leftChildIndex();
+            children[childCount++] = opened.rightChildIndex();
+        }
+
+        const NodeIndex wideIndex = NodeIndex(nodes.size());
+        nodes.emplace_back();
+        for (int axis = 0; axis < 3; axis++) {
+            for (int i = 0; i < Width; i++) {
+                nodes[wideIndex].bounds[0][axis][i] = +Infinity;
+                nodes[wideIndex].bounds[1][axis][i] = -Infinity;
+            }
+        }
+
+        for (int i = 0; i < Width; i++) {
+            NodeIndex index = -1, primitiveCount = 0;
+            if (i < childCount) {
+                if (becomesLeaf(children[i])) {
+                    index          = ranges[children[i]].first;
+                    primitiveCount = ranges[children[i]].count;
+                } else {
+                    // note that this invalidates references into nodes
+                    index = collapse<Width>(ranges, children[i]);
+                }
+                const Bounds &aabb = m_nodes[children[i]].aabb;
+                for (int axis = 0; axis < 3; axis++) {
+                    nodes[wideIndex].bounds[0][axis][i] = aabb.min()[axis];
+                    nodes[wideIndex].bounds[1][axis][i] = aabb.max()[axis];
+                }
+            }
+            nodes[wideIndex].children[i]        = index;
+            nodes[wideIndex].primitiveCounts[i] = primitiveCount;
+        }
+        return wideIndex;
+    }
+
+    /// @brief Collapses the binary BVH into a wide BVH, after which only the
+    /// root of the binary BVH is kept.
+    template <int Width> void buildWideBVH() {
+        // children are always allocated after their parents, so iterating
+        // backwards visits children first
+        std::vector<PrimitiveRange> ranges(m_nodes.size());
+        for (NodeIndex i = NodeIndex(m_nodes.size()) - 1; i >= 0; i--) {
+            const Node &node = m_nodes[i];
+            if (node.isLeaf()) {
+                ranges[i] = { node.firstPrimitiveIndex(), node.primitiveCount };
+            } else {
+                const PrimitiveRange &left  = ranges[node.leftChildIndex()];
+                const PrimitiveRange &right = ranges[node.rightChildIndex()];
+                ranges[i] = { left.first, left.count + right.count };
+            }
+        }
+
+        std::vector<WideNode<Width>> &nodes = wideNodes<Width>();
+        nodes.reserve(m_nodes.size() / (Width - 1) + 1);
+        collapse<Width>(ranges, 0);
+        nodes.shrink_to_fit();
+
+        m_nodes.resize(1);
+        m_nodes.shrink_to_fit();
     }
 
 protected:
+    AccelerationStructure() = default;
+    /// @brief Reads the BVH branching factor from the @c accel attribute.
+    AccelerationStructure(const Properties &properties) {
+        m_width = properties.getEnum<int>(
+            "accel", 2, { { "bvh2", 2 }, { "bvh4", 4 }, { "bvh8", 8 } });
+    }
+
     /// @brief Returns the number of children (individual shapes) that are part
     /// of this acceleration structure.
     virtual int numberOfPrimitives() const = 0;
@@ -341,31 +955,221 @@ protected:
     /// ray.
     virtual bool intersect(int primitiveIndex, const Ray &ray,
                            Intersection &its, Sampler &rng) const = 0;
+    /// @brief Tests whether a single child (identified by the index) has any
+    /// intersection with the given ray that is closer than @c tMax .
+    virtual bool occluded(int primitiveIndex, const Ray &ray, float tMax,
+                          Sampler &rng) const = 0;
     /// @brief Returns the axis aligned bounding box of the given child.
     virtual Bounds getBoundingBox(int primitiveIndex) const = 0;
     /// @brief Returns the centroid of the given child.
     virtual Point getCentroid(int primitiveIndex) const = 0;
 
-    /// @brief Builds the acceleration structure.
+    /**
+     * @brief Intersects all children of a BVH leaf with the given ray. The
+     * children are given by a range of positions, which can be translated to
+     * primitive indices using @ref primitiveAt .
+     * The default implementation intersects one child after another, shapes
+     * can override this to test several children at once.
+     */
+    virtual bool intersectLeaf(int first, int count, const Ray &ray,
+                               Intersection &its, Sampler &rng) const {
+        bool wasIntersected = false;
+        for (int i = 0; i < count; i++) {
+            // update the statistic tracking how many children have been tested
+            // for intersection
+            its.stats.primCounter++;
+            // test the child for intersection
+            wasIntersected |= intersect(primitiveAt(first + i), ray, its, rng);
+        }
+        return wasIntersected;
+    }
+
+    /// @brief Tests whether any child of a BVH leaf intersects the given ray
+    /// closer than @c tMax (see @ref intersectLeaf ).
+    virtual bool occludedLeaf(int first, int count, const Ray &ray, float tMax,
+                              Sampler &rng) const {
+        for (int i = 0; i < count; i++) {
+            if (occluded(primitiveAt(first + i), ray, tMax, rng))
+                return true;
+        }
+        return false;
+    }
+
+    /// @brief Returns the primitive index stored at a given position of the
+    /// BVH leaves.
+    int primitiveAt(int position) const { return m_primitiveIndices[position]; }
+
+    /**
+     * @brief Invokes @c f with the range of positions (first, count) of each
+     * leaf of the BVH that is used for traversal, which allows shapes to
+     * prepare per-leaf data after building.
+     */
+    template <typename F> void forEachLeaf(F f) const {
+        if (m_primitiveIndices.empty())
+            return;
+
+        auto visitWide = [&](const auto &nodes) {
+            for (const auto &node : nodes) {
+                for (int i = 0; i < int(std::size(node.children)); i++) {
+                    if (node.primitiveCounts[i])
+                        f(node.children[i], node.primitiveCounts[i]);
+                }
+            }
+        };
+
+        switch (m_width) {
+        case 4:
+            visitWide(m_nodes4);
+            break;
+        case 8:
+            visitWide(m_nodes8);
+            break;
+        default:
+            for (const Node &node : m_nodes) {
+                if (node.isLeaf())
+                    f(node.firstPrimitiveIndex(), node.primitiveCount);
+            }
+        }
+    }
+
+    /**
+     * @brief The result of building the acceleration structure, which only
+     * depends on the BVH width and the bounding boxes and centroids of the
+     * primitives (see @ref layoutFingerprint ).
+     */
+    struct Hierarchy {
+        std::vector<Node> nodes;
+        std::vector<WideNode<4>> nodes4;
+        std::vector<WideNode<8>> nodes8;
+        std::vector<int> primitiveIndices;
+    };
+
+    /// @brief Returns a copy of the hierarchy that has been built.
+    Hierarchy hierarchy() const {
+        return { m_nodes, m_nodes4, m_nodes8, m_primitiveIndices };
+    }
+
+    /// @brief Uses a hierarchy that has been built for primitives with the
+    /// same layout instead of building the acceleration structure.
+    void setHierarchy(const Hierarchy &hierarchy) {
+        m_nodes            = hierarchy.nodes;
+        m_nodes4           = hierarchy.nodes4;
+        m_nodes8           = hierarchy.nodes8;
+        m_primitiveIndices = hierarchy.primitiveIndices;
+    }
+
+    /// @brief Hashes everything the built hierarchy depends on, i.e., the BVH
+    /// width and the bounding box and centroid of every primitive.
+    uint64_t layoutFingerprint() const {
+        hash::fnv1a fingerprint{ m_width, numberOfPrimitives() };
+        for (int primitiveIndex = 0; primitiveIndex < numberOfPrimitives();
+             primitiveIndex++) {
+            const Bounds bounds  = getBoundingBox(primitiveIndex);
+            const Point centroid = getCentroid(primitiveIndex);
+            for (int dim = 0; dim < 3; dim++) {
+                fingerprint << std::bit_cast<uint32_t>(bounds.min()[dim])
+                            << std::bit_cast<uint32_t>(bounds.max()[dim])
+                            << std::bit_cast<uint32_t>(centroid[dim]);
+            }
+        }
+        return fingerprint;
+    }
+
+    /**
+     * @brief Builds the acceleration structure.
+     * The top levels of the tree are split one after another, with each split
+     * being computed in parallel. Once nodes become small enough, the
+     * remaining subtrees are built in parallel as independent tasks.
+     */
     void buildAccelerationStructure() {
         Timer buildTimer;
+        const int primitiveCount = numberOfPrimitives();
 
         // fill primitive indices with 0 to primitiveCount - 1
-        m_primitiveIndices.resize(numberOfPrimitives());
+        m_primitiveIndices.resize(primitiveCount);
         std::iota(m_primitiveIndices.begin(), m_primitiveIndices.end(), 0);
 
+        // query bounding boxes and centroids of all primitives once
+        BuildContext ctx;
+        for (int dim = 0; dim < 3; dim++) {
+            ctx.centroids[dim].resize(primitiveCount);
+            ctx.boundsMin[dim].resize(primitiveCount);
+            ctx.boundsMax[dim].resize(primitiveCount);
+        }
+        for_each_parallel(
+            ChunkedRange(primitiveCount, ChunkSize), [&](const Range &range) {
+                for (int primitiveIndex : range) {
+                    const Point centroid = getCentroid(primitiveIndex);
+                    const Bounds bounds  = getBoundingBox(primitiveIndex);
+                    for (int dim = 0; dim < 3; dim++) {
+                        ctx.centroids[dim][primitiveIndex] = centroid[dim];
+                        ctx.boundsMin[dim][primitiveIndex] = bounds.min()[dim];
+                        ctx.boundsMax[dim][primitiveIndex] = bounds.max()[dim];
+                    }
+                }
+            });
+
+        // a binary tree with at most one primitive per leaf has at most
+        // 2n - 1 nodes, so we can allocate all nodes upfront and let build
+        // tasks claim them without synchronization
+        m_nodes.resize(std::max(1, 2 * primitiveCount - 1));
+        ctx.nodeCount = 1;
+
         // create root node
-        auto &root          = m_nodes.emplace_back();
+        auto &root          = m_nodes.front();
         root.leftFirst      = 0;
-        root.primitiveCount = numberOfPrimitives();
-        computeAABB(root);
-        subdivide(root);
+        root.primitiveCount = primitiveCount;
+        computeAABB(ctx, root);
+
+        // split the top of the tree breadth first, until nodes are small enough
+        // to be built as independent tasks
+        std::vector<std::pair<NodeIndex, int>> subtrees;
+        std::vector<std::pair<NodeIndex, int>> frontier = { { 0, 0 } };
+        while (!frontier.empty()) {
+            std::vector<std::pair<NodeIndex, int>> nextFrontier;
+            for (const auto &[nodeIndex, depth] : frontier) {
+                if (m_nodes[nodeIndex].primitiveCount < ParallelThreshold) {
+                    subtrees.emplace_back(nodeIndex, depth);
+                } else if (split(ctx, nodeIndex, depth)) {
+                    const Node &node = m_nodes[nodeIndex];
+                    nextFrontier.emplace_back(node.leftChildIndex(), depth + 1);
+                    nextFrontier.emplace_back(node.rightChildIndex(),
+                                              depth + 1);
+                }
+            }
+            frontier = std::move(nextFrontier);
+        }
+
+        if (subtrees.size() == 1) {
+            // not worth spawning threads for small acceleration structures
+            subdivide(ctx, subtrees.front().first, subtrees.front().second);
+        } else {
+            for_each_parallel(subtrees.begin(),
+                              subtrees.end(),
+                              [&](const std::pair<NodeIndex, int> &subtree) {
+                                  subdivide(ctx, subtree.first, subtree.second);
+                              });
+        }
+
+        m_nodes.resize(ctx.nodeCount);
+        m_nodes.shrink_to_fit();
+        const size_t binaryNodeCount = m_nodes.size();
+
+        if (m_width == 4)
+            buildWideBVH<4>();
+        else if (m_width == 8)
+            buildWideBVH<8>();
 
         logger(EInfo,
-               "built BVH with %ld nodes for %ld primitives in %.1f ms",
-               m_nodes.size(),
-               numberOfPrimitives(),
-               buildTimer.getElapsedTime() * 1000);
+               "built BVH%d with %ld nodes for %ld primitives in %.1f ms "
+               "(%d parallel subtrees)",
+               m_width,
+               m_width == 4   ? m_nodes4.size()
+               : m_width == 8 ? m_nodes8.size()
+                              : binaryNodeCount,
+               primitiveCount,
+               buildTimer.getElapsedTime() * 1000,
+               subtrees.size());
     }
 
 public:
@@ -373,14 +1177,99 @@ public:
                    Sampler &rng) const override {
         if (m_primitiveIndices.empty())
             return false; // exit early if no children exist
-        if (intersectAABB(rootNode().aabb, ray) <
-            its.t) // test root bounding box for potential hit
-            return intersectNode(rootNode(), ray, its, rng);
-        return false;
+        switch (m_width) {
+        case 4:
+            return intersectWideNodes<4>(ray, its, rng);
+        case 8:
+            return intersectWideNodes<8>(ray, its, rng);
+        default:
+            return intersectNodes(ray, its, rng);
+        }
+    }
+
+    bool occluded(const Ray &ray, float tMax, Sampler &rng) const override {
+        if (m_primitiveIndices.empty())
+            return false; // exit early if no children exist
+        switch (m_width) {
+        case 4:
+            return occludedWideNodes<4>(ray, tMax, rng);
+        case 8:
+            return occludedWideNodes<8>(ray, tMax, rng);
+        default:
+            return occludedNodes(ray, tMax, rng);
+        }
     }
 
     Bounds getBoundingBox() const override { return rootNode().aabb; }
 
+    /**
+     * @brief Transforms the bounding boxes of the top levels of the BVH
+     * instead of only the root, which gives much tighter bounds for rotated
+     * acceleration structures (e.g., instanced triangle meshes).
+     */
+    Bounds getTransformedBoundingBox(
+        const Transform &transform) const override {
+        if (m_primitiveIndices.empty())
+            return transformBounds(getBoundingBox(), transform);
+
+        Bounds result;
+        auto extendChild = [&](const auto &node, int child) {
+            const Bounds bounds{ { node.bounds[0][0][child],
+                                   node.bounds[0][1][child],
+                                   node.bounds[0][2][child] },
+                                 { node.bounds[1][0][child],
+                                   node.bounds[1][1][child],
+                                   node.bounds[1][2][child] } };
+            result.extend(transformBounds(bounds, transform));
+        };
+        auto visitWide = [&](const auto &nodes) {
+            // transform the children of the root, or the grandchildren for
+            // internal children of the root
+            const auto &root = nodes.front();
+            for (int i = 0; i < int(std::size(root.children)); i++) {
+                if (root.children[i] == -1)
+                    continue;
+                if (root.primitiveCounts[i]) {
+                    extendChild(root, i);
+                    continue;
+                }
+                const auto &node = nodes[root.children[i]];
+                for (int j = 0; j < int(std::size(node.children)); j++) {
+                    if (node.children[j] != -1)
+                        extendChild(node, j);
+                }
+            }
+        };
+
+        switch (m_width) {
+        case 4:
+            visitWide(m_nodes4);
+            break;
+        case 8:
+            visitWide(m_nodes8);
+            break;
+        default: {
+            // transform the nodes of the first few levels of the tree
+            static constexpr int TransformedLevels = 4;
+            std::vector<NodeIndex> level = { 0 };
+            for (int depth = 0; depth < TransformedLevels; depth++) {
+                std::vector<NodeIndex> nextLevel;
+                for (NodeIndex index : level) {
+                    const Node &node = m_nodes[index];
+                    if (node.isLeaf() || depth == TransformedLevels - 1) {
+                        result.extend(transformBounds(node.aabb, transform));
+                    } else {
+                        nextLevel.push_back(node.leftChildIndex());
+                        nextLevel.push_back(node.rightChildIndex());
+                    }
+                }
+                level = std::move(nextLevel);
+            }
+        }
+        }
+        return result;
+    }
+
     Point getCentroid() const override { return rootNode().aabb.center(); }
 };
 
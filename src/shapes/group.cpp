@@ -2,6 +2,9 @@
 
 #include "accel.hpp"
 
+#include <deque>
+#include <mutex>
+
 namespace lightwave {
 
 /**
@@ -22,6 +25,11 @@ protected:
         return m_children[primitiveIndex]->intersect(ray, its, rng);
     }
 
+    bool occluded(int primitiveIndex, const Ray &ray, float tMax,
+                  Sampler &rng) const override {
+        return m_children[primitiveIndex]->occluded(ray, tMax, rng);
+    }
+
     Bounds getBoundingBox(int primitiveIndex) const override {
         return m_children[primitiveIndex]->getBoundingBox();
     }
@@ -30,10 +38,45 @@ protected:
         return m_children[primitiveIndex]->getCentroid();
     }
 
+    /// @brief The number of recently built hierarchies that are kept, so
+    /// that reloading a scene only rebuilds the BVH over its instances if
+    /// their transforms or shapes have changed.
+    static constexpr int CachedHierarchies = 4;
+
+    /// @brief Reuses a recently built hierarchy for children with exactly the
+    /// same bounding boxes and centroids, or builds a new one.
+    void buildOrReuseHierarchy() {
+        typedef std::pair<uint64_t, std::shared_ptr<const Hierarchy>> Entry;
+        static std::mutex mutex;
+        static std::deque<Entry> cache;
+
+        const uint64_t fingerprint = layoutFingerprint();
+        {
+            std::unique_lock lock{ mutex };
+            for (const auto &[key, hierarchy] : cache) {
+                if (key == fingerprint) {
+                    logger(EInfo,
+                           "reusing BVH of %d unchanged children",
+                           m_children.size());
+                    setHierarchy(*hierarchy);
+                    return;
+                }
+            }
+        }
+
+        buildAccelerationStructure();
+
+        std::unique_lock lock{ mutex };
+        cache.emplace_front(fingerprint,
+                            std::make_shared<const Hierarchy>(hierarchy()));
+        if (cache.size() > CachedHierarchies)
+            cache.pop_back();
+    }
+
 public:
-    Group(const Properties &properties) {
+    Group(const Properties &properties) : AccelerationStructure(properties) {
         m_children = properties.getChildren<Shape>();
-        buildAccelerationStructure();
+        buildOrReuseHierarchy();
     }
 
     void markAsVisible() override {
@@ -2,6 +2,14 @@
 
 #include "../core/plyparser.hpp"
 #include "accel.hpp"
+#include "spherical.hpp"
+#include "trianglepacket.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <map>
+#include <mutex>
 
 namespace lightwave {
 
@@ -26,6 +34,14 @@ class TriangleMesh : public AccelerationStructure {
      * fewer than @code 3 * numTriangles @endcode vertices.
      */
     std::vector<Vertex> m_vertices;
+    /**
+     * @brief The triangles of each BVH leaf, precomputed and grouped into
+     * packets (padded as needed) that are intersected using SIMD instructions.
+     */
+    std::vector<TrianglePacket> m_packets;
+    /// @brief For the first position of each BVH leaf, the index of its first
+    /// packet in m_packets.
+    std::vector<int> m_packetOffsets;
     /// @brief The file this mesh was loaded from, for logging and debugging
     /// purposes.
     std::filesystem::path m_originalPath;
@@ -33,146 +49,286 @@ class TriangleMesh : public AccelerationStructure {
     /// geometric normal instead.
     bool m_smoothNormals;
 
+    /// @brief Picks triangles proportionally to their area when sampling
+    /// points on the mesh. Only built once the mesh is sampled (i.e., used as
+    /// area light), see @ref triangleDistribution .
+    mutable AliasTable m_triangleDistribution;
+    mutable std::once_flag m_triangleDistributionBuilt;
+    /// @brief Whether @c m_triangleDistribution has been built, which
+    /// intersections check to report the density of sampling the hit point.
+    mutable std::atomic<bool> m_isSampleable = false;
+
 protected:
     int numberOfPrimitives() const override { return int(m_triangles.size()); }
 
-    bool intersect(int primitiveIndex, const Ray &ray, Intersection &its,
-                   Sampler &rng) const override {
-        // NOT_IMPLEMENTED
-
-        // hints:
-        // * use m_triangles[primitiveIndex] to get the vertex indices of the
-        // triangle that should be intersected
-        // * if m_smoothNormals is true, interpolate the vertex normals from
-        // m_vertices
-        //   * make sure that your shading frame stays orthonormal!
-        // * if m_smoothNormals is false, use the geometrical normal (can be
-        // computed from the vertex positions)
-        
-        int i0 = m_triangles[primitiveIndex][0];
-        int i1 = m_triangles[primitiveIndex][1];
-        int i2 = m_triangles[primitiveIndex][2];
-
-        Vertex p0 = m_vertices[i0];
-        Vertex p1 = m_vertices[i1];
-        Vertex p2 = m_vertices[i2];
-
-        // compute edges
-        Vector e0 = p1.position - p0.position;
-        Vector e1 = p2.position - p0.position;
-
-        Vector normal = e0.cross(e1).normalized();
-
-        //check if triangle is degenerate 
-        if (normal.lengthSquared() == 0)
-            return false;
-
-        Vector p_vec = ray.direction.cross(e1);
-        float det = e0.dot(p_vec);
+    /// @brief Returns the precomputed triangle for a given primitive index.
+    PrecomputedTriangle precomputedTriangle(int primitiveIndex) const {
+        const Vector3i &triangle = m_triangles[primitiveIndex];
+        return { m_vertices[triangle[0]].position,
+                 m_vertices[triangle[1]].position,
+                 m_vertices[triangle[2]].position };
+    }
 
-        //check for backface culling
-        // if (det < Epsilon) return false;
+    /**
+     * @brief Computes the texture coordinates and shading frame of a point on
+     * a triangle, given by its barycentric coordinates.
+     */
+    void populate(SurfaceEvent &surf, int primitiveIndex,
+                  const Vector2 &barycentric) const {
+        const Vector3i &triangle = m_triangles[primitiveIndex];
+        const Vertex &p0         = m_vertices[triangle[0]];
+        const Vertex &p1         = m_vertices[triangle[1]];
+        const Vertex &p2         = m_vertices[triangle[2]];
 
-        if (fabs(det) < 1e-6) return false; // Reducing epsilon made it work for bunny (?)
+        const Vector e0     = p1.position - p0.position;
+        const Vector e1     = p2.position - p0.position;
+        const Vector normal = e0.cross(e1).normalized();
 
-        float inv_det = 1 / det;
+        surf.geometryNormal = normal;
 
-        Vector t_vec = ray.origin - p0.position;
-        float u = t_vec.dot(p_vec) * inv_det;
-        if (u < 0 || u > 1) return false;
+        surf.uv = interpolateBarycentric(barycentric, p0.uv, p1.uv, p2.uv);
 
-        Vector q_vec = t_vec.cross(e0);
-        float v = ray.direction.dot(q_vec) * inv_det;
-        if (v < 0 || u + v > 1) return false;
-        
-        float t = e1.dot(q_vec) * inv_det;
+        if (m_smoothNormals)
+            surf.shadingNormal = interpolateBarycentric(barycentric, p0.normal, p1.normal, p2.normal).normalized();
+        else
+            surf.shadingNormal = normal;
 
-        if (t < Epsilon || t > its.t) return false;
+        surf.tangent = e0.normalized(); // Creating tangent from a vector on the mesh plane
+    }
 
-        its.t = t;
-        its.geometryNormal = normal;
+    /**
+     * @brief Computes the surface attributes of the hit recorded in the
+     * intersection (by its primitive index and barycentric coordinates).
+     * This only happens once the closest hit of the mesh is known.
+     */
+    void populate(Intersection &its, const Ray &ray) const {
+        populate(its, its.primitiveIndex, its.barycentric);
+        its.position = ray(its.t);
+        // the density of sampling the hit point from the origin of the ray,
+        // for meshes that are used as area lights (other instances of the same
+        // mesh do not need it)
+        const bool isLight =
+            its.needsPdf && m_isSampleable.load(std::memory_order_acquire);
+        its.pdf = isLight ? pdf(its, its.primitiveIndex, &ray.origin) : 0;
+    }
 
-        its.uv = interpolateBarycentric(Vector2(u, v), p0.uv, p1.uv, p2.uv);
+    /// @brief Returns the area of a triangle.
+    float triangleArea(int primitiveIndex) const {
+        const PrecomputedTriangle triangle = precomputedTriangle(primitiveIndex);
+        return triangle.edge0.cross(triangle.edge1).length() / 2;
+    }
 
-        if (m_smoothNormals)
-            // its.shadingNormal = ((1 - u - v) * p0.normal + u * p1.normal + v * p2.normal).normalized();
-            its.shadingNormal = interpolateBarycentric(Vector2(u, v), p0.normal, p1.normal, p2.normal).normalized();
-        else
-            its.shadingNormal = normal;
+    /// @brief Returns the distribution over triangles, which is built on
+    /// first use.
+    const AliasTable &triangleDistribution() const {
+        std::call_once(m_triangleDistributionBuilt, [&]() {
+            std::vector<float> areas(m_triangles.size());
+            for (int i = 0; i < int(m_triangles.size()); i++)
+                areas[i] = triangleArea(i);
+            m_triangleDistribution = AliasTable(areas);
+            m_isSampleable.store(true, std::memory_order_release);
+        });
+        return m_triangleDistribution;
+    }
 
-        its.tangent = e0.normalized(); // Creating tangent from a vector on the mesh plane
+    /**
+     * @brief Returns whether a triangle is sampled by the solid angle it
+     * covers as seen from a point, rather than by area. The solid angle is
+     * returned via @c solidAngle .
+     */
+    bool samplesSolidAngle(int primitiveIndex, const Point &origin,
+                           float &solidAngle) const {
+        const Vector3i &triangle = m_triangles[primitiveIndex];
+        solidAngle = sphericalTriangleArea(m_vertices[triangle[0]].position,
+                                           m_vertices[triangle[1]].position,
+                                           m_vertices[triangle[2]].position,
+                                           origin);
+        return solidAngle >= MinSphericalSampleArea &&
+               solidAngle <= MaxSphericalSampleArea;
+    }
 
-        its.pdf = 0.0f;
-        its.position = ray(its.t);
-        
-        return true;
-    
+    /**
+     * @brief Returns the density (in area units) of sampling a point on the
+     * mesh via @ref sampleArea , with or without a reference point.
+     */
+    float pdf(const SurfaceEvent &surf, int primitiveIndex,
+              const Point *origin) const {
+        const float selection =
+            m_triangleDistribution.probability(primitiveIndex);
+        float solidAngle;
+        if (origin && samplesSolidAngle(primitiveIndex, *origin, solidAngle)) {
+            const auto [distance, wi] =
+                (surf.position - *origin).lengthAndNormalized();
+            return selection * abs(surf.geometryNormal.dot(wi)) /
+                   (sqr(distance) * solidAngle);
+        }
+        return selection / triangleArea(primitiveIndex);
     }
 
-    Bounds getBoundingBox(int primitiveIndex) const override {
-        // NOT_IMPLEMENTED
-        int i0 = m_triangles[primitiveIndex][0];
-        int i1 = m_triangles[primitiveIndex][1];
-        int i2 = m_triangles[primitiveIndex][2];
+    /// @brief Samples a point on the mesh, optionally by the solid angle of
+    /// the picked triangle as seen from a reference point.
+    AreaSample sample(Sampler &rng, const Point *origin) const {
+        const AliasTable &distribution = triangleDistribution();
+        if (distribution.empty())
+            return AreaSample::invalid();
+
+        const int primitiveIndex = distribution.sample(rng.next2D());
+        const Point2 rnd         = rng.next2D();
+        const Vector3i &triangle = m_triangles[primitiveIndex];
+        const Point &p0          = m_vertices[triangle[0]].position;
+        const Point &p1          = m_vertices[triangle[1]].position;
+        const Point &p2          = m_vertices[triangle[2]].position;
+
+        Vector2 barycentric;
+        float solidAngle;
+        if (origin && samplesSolidAngle(primitiveIndex, *origin, solidAngle)) {
+            const auto sampled =
+                sampleSphericalTriangle(p0, p1, p2, *origin, rnd);
+            if (!sampled)
+                return AreaSample::invalid();
+            barycentric = *sampled;
+        } else {
+            barycentric = squareToUniformTriangle(rnd);
+        }
+
+        AreaSample sample;
+        populate(sample, primitiveIndex, barycentric);
+        sample.position = interpolateBarycentric(barycentric, p0, p1, p2);
+        sample.pdf      = pdf(sample, primitiveIndex, origin);
+        return sample;
+    }
 
-        Vertex p0 = m_vertices[i0];
-        Vertex p1 = m_vertices[i1];
-        Vertex p2 = m_vertices[i2];
+    bool intersect(int primitiveIndex, const Ray &ray, Intersection &its,
+                   Sampler &rng) const override {
+        float t;
+        Vector2 barycentric;
+        if (!precomputedTriangle(primitiveIndex)
+                 .intersect(ray, its.t, t, barycentric))
+            return false;
 
-        auto x_min = std::min({p0.position[0], p1.position[0], p2.position[0]});
-        auto y_min = std::min({p0.position[1], p1.position[1], p2.position[1]});
-        auto z_min = std::min({p0.position[2], p1.position[2], p2.position[2]});
+        // only record the hit, its attributes are computed by populate
+        its.t              = t;
+        its.primitiveIndex = primitiveIndex;
+        its.barycentric    = barycentric;
+        return true;
+    }
 
-        
-        auto x_max = std::max({p0.position[0], p1.position[0], p2.position[0]});
-        auto y_max = std::max({p0.position[1], p1.position[1], p2.position[1]});
-        auto z_max = std::max({p0.position[2], p1.position[2], p2.position[2]});
+    bool occluded(int primitiveIndex, const Ray &ray, float tMax,
+                  Sampler &rng) const override {
+        float t;
+        Vector2 barycentric;
+        return precomputedTriangle(primitiveIndex)
+            .intersect(ray, tMax, t, barycentric);
+    }
 
-        return Bounds(Point(x_min, y_min, z_min), Point(x_max, y_max, z_max));
+    bool intersectLeaf(int first, int count, const Ray &ray, Intersection &its,
+                       Sampler &rng) const override {
+        its.stats.primCounter += count;
+
+        bool wasIntersected = false;
+        const int packetCount =
+            (count + TrianglePacket::Width - 1) / TrianglePacket::Width;
+        for (int i = 0; i < packetCount; i++) {
+            const TrianglePacket &packet = m_packets[m_packetOffsets[first] + i];
+            float t;
+            Vector2 barycentric;
+            const int lane = packet.intersect(ray, its.t, t, barycentric);
+            if (lane == -1)
+                continue;
+
+            // only record the hit, its attributes are computed by populate
+            its.t              = t;
+            its.primitiveIndex = packet.primitiveIndices[lane];
+            its.barycentric    = barycentric;
+            wasIntersected     = true;
+        }
+        return wasIntersected;
     }
 
-    Point getCentroid(int primitiveIndex) const override {
-        // NOT_IMPLEMENTED
+    bool occludedLeaf(int first, int count, const Ray &ray, float tMax,
+                      Sampler &rng) const override {
+        const int packetCount =
+            (count + TrianglePacket::Width - 1) / TrianglePacket::Width;
+        for (int i = 0; i < packetCount; i++) {
+            if (m_packets[m_packetOffsets[first] + i].occluded(ray, tMax))
+                return true;
+        }
+        return false;
+    }
 
-        int i0 = m_triangles[primitiveIndex][0];
-        int i1 = m_triangles[primitiveIndex][1];
-        int i2 = m_triangles[primitiveIndex][2];
+    /// @brief Groups the triangles of each BVH leaf into packets.
+    void buildPackets() {
+        m_packetOffsets.assign(m_triangles.size(), -1);
+        forEachLeaf([&](int first, int count) {
+            m_packetOffsets[first] = int(m_packets.size());
+            for (int i = 0; i < count; i++) {
+                if (i % TrianglePacket::Width == 0)
+                    m_packets.emplace_back();
+                const int primitiveIndex = primitiveAt(first + i);
+                m_packets.back().set(i % TrianglePacket::Width,
+                                     precomputedTriangle(primitiveIndex),
+                                     primitiveIndex);
+            }
+        });
+        m_packets.shrink_to_fit();
+    }
 
-        Vertex p0 = m_vertices[i0];
-        Vertex p1 = m_vertices[i1];
-        Vertex p2 = m_vertices[i2];
+    Bounds getBoundingBox(int primitiveIndex) const override {
+        const Vector3i &triangle = m_triangles[primitiveIndex];
+        const Point &p0          = m_vertices[triangle[0]].position;
+        const Point &p1          = m_vertices[triangle[1]].position;
+        const Point &p2          = m_vertices[triangle[2]].position;
 
-        auto x = (p0.position[0] + p1.position[0] + p2.position[0]) / 3;
-        auto y = (p0.position[1] + p1.position[1] + p2.position[1]) / 3;
-        auto z = (p0.position[2] + p1.position[2] + p2.position[2]) / 3;
+        return Bounds(elementwiseMin(p0, elementwiseMin(p1, p2)),
+                      elementwiseMax(p0, elementwiseMax(p1, p2)));
+    }
 
-        Point centroid = Point(x, y, z);
-        return centroid;
+    Point getCentroid(int primitiveIndex) const override {
+        const Vector3i &triangle = m_triangles[primitiveIndex];
+        const Point &p0          = m_vertices[triangle[0]].position;
+        const Point &p1          = m_vertices[triangle[1]].position;
+        const Point &p2          = m_vertices[triangle[2]].position;
 
+        return Point((Vector(p0) + Vector(p1) + Vector(p2)) / 3);
     }
 
 public:
-    TriangleMesh(const Properties &properties) {
+    TriangleMesh(const Properties &properties)
+        : AccelerationStructure(properties) {
         m_originalPath  = properties.get<std::filesystem::path>("filename");
         m_smoothNormals = properties.get<bool>("smooth", true);
         readPLY(m_originalPath, m_triangles, m_vertices);
+
         logger(EInfo,
                "loaded ply with %d triangles, %d vertices",
                m_triangles.size(),
                m_vertices.size());
         buildAccelerationStructure();
+        buildPackets();
     }
 
     bool intersect(const Ray &ray, Intersection &its,
                    Sampler &rng) const override {
         PROFILE("Triangle mesh")
-        return AccelerationStructure::intersect(ray, its, rng);
+        if (!AccelerationStructure::intersect(ray, its, rng))
+            return false;
+
+        populate(its, ray);
+        return true;
+    }
+
+    bool occluded(const Ray &ray, float tMax, Sampler &rng) const override {
+        PROFILE("Triangle mesh")
+        return AccelerationStructure::occluded(ray, tMax, rng);
+    }
+
+    AreaSample sampleArea(Sampler &rng) const override {
+        return sample(rng, nullptr);
     }
 
-    AreaSample sampleArea(Sampler &rng) const override{
-        // only implement this if you need triangle mesh area light sampling for
-        // your rendering competition
-        NOT_IMPLEMENTED
+    AreaSample sampleArea(Sampler &rng,
+                          const SurfaceEvent &ref) const override {
+        return sample(rng, &ref.position);
     }
 
     std::string toString() const override {
@@ -188,6 +344,76 @@ public:
     }
 };
 
-} // namespace lightwave
+/**
+ * @brief Creates triangle meshes, but loads each file only once: all shapes
+ * that reference the same file with the same settings share a single
+ * TriangleMesh, and hence a single BVH. This way, a forest of many instances
+ * of the same tree only costs the memory of one tree.
+ * @note The cache only holds weak references, so meshes are released as soon
+ * as no scene uses them anymore (e.g., older versions of an edited file).
+ */
+static ref<Object> createSharedTriangleMesh(const Properties &properties) {
+    static std::mutex mutex;
+    static std::map<std::string, std::shared_future<std::weak_ptr<Object>>>
+        cache;
+
+    // the modification time is part of the key, so that files that have been
+    // changed on disk will be loaded again
+    const auto path = properties.get<std::filesystem::path>("filename");
+    std::error_code error;
+    const std::string key = tfm::format(
+        "%s|%d|%s|%d",
+        std::filesystem::weakly_canonical(path, error).generic_string(),
+        properties.get<bool>("smooth", true),
+        properties.get<std::string>("accel", "bvh2"),
+        std::filesystem::last_write_time(path, error)
+            .time_since_epoch()
+            .count());
+
+    std::promise<std::weak_ptr<Object>> promise;
+    while (true) {
+        std::shared_future<std::weak_ptr<Object>> pending;
+        {
+            std::unique_lock lock{ mutex };
+            // forget meshes that have been loaded but are no longer used
+            std::erase_if(cache, [](const auto &entry) {
+                const auto &future = entry.second;
+                return future.wait_for(std::chrono::seconds(0)) ==
+                           std::future_status::ready &&
+                       future.get().expired();
+            });
+
+            const auto it = cache.find(key);
+            if (it == cache.end()) {
+                cache.emplace(key, promise.get_future().share());
+                break;
+            }
+            pending = it->second;
+        }
+
+        if (const auto mesh = pending.get().lock()) {
+            logger(EInfo, "reusing mesh %s", path.generic_string());
+            return mesh;
+        }
+        // the mesh has been released while we were waiting for it
+    }
 
-REGISTER_SHAPE(TriangleMesh, "mesh")
+    try {
+        const ref<Object> mesh(new TriangleMesh(properties));
+        promise.set_value(mesh);
+        return mesh;
+    } catch (...) {
+        // forget the failed attempt, but let concurrent requests fail as well
+        {
+            std::unique_lock lock{ mutex };
+            cache.erase(key);
+        }
+        promise.set_exception(std::current_exception());
+        lightwave_throw_nested("while creating TriangleMesh object");
+    }
+}
+
+static Registry::Registrar<TriangleMesh>
+    meshRegistrar("shape", "mesh", createSharedTriangleMesh);
+
+} // namespace lightwave
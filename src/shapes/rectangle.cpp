@@ -1,9 +1,34 @@
 #include <lightwave.hpp>
 
+#include "spherical.hpp"
+
 namespace lightwave {
 
 /// @brief A rectangle in the xy-plane, spanning from [-1,-1,0] to [+1,+1,0].
 class Rectangle : public Shape {
+    /// @brief Whether area lights sample the rectangle by the solid angle it
+    /// covers as seen from the illuminated point, rather than by area.
+    bool m_improved;
+
+    /// @brief Returns the rectangle as seen from a point.
+    static SphericalRectangle seenFrom(const Point &origin) {
+        return { origin, Point2(-1, -1), Point2(+1, +1) };
+    }
+
+    /// @brief Returns whether sampling by solid angle is robust for the given
+    /// rectangle as seen from a point.
+    static bool samplesSolidAngle(const SphericalRectangle &rectangle) {
+        return rectangle.solidAngle() >= MinSphericalSampleArea &&
+               rectangle.solidAngle() <= MaxSphericalSampleArea;
+    }
+
+    /// @brief Converts the density of sampling a point uniformly by solid
+    /// angle into area units.
+    static float solidAnglePdf(const SphericalRectangle &rectangle,
+                               const Point &position, const Point &origin) {
+        const auto [distance, wi] = (position - origin).lengthAndNormalized();
+        return abs(wi.z()) / (sqr(distance) * rectangle.solidAngle());
+    }
     /**
      * @brief Constructs a surface event for a given position, used by @ref
      * intersect to populate the @ref Intersection and by @ref sampleArea to
@@ -31,13 +56,14 @@ class Rectangle : public Shape {
         surf.pdf = 1.0f / 4;
     }
 
-public:
-    Rectangle(const Properties &properties) {}
-
-    bool intersect(const Ray &ray, Intersection &its,
-                   Sampler &rng) const override {
-        PROFILE("Rectangle")
-
+    /**
+     * @brief Intersects the ray with the rectangle without computing any
+     * surface attributes, shared by @ref intersect and @ref occluded .
+     * @param tMax Only intersections closer than this distance are reported
+     * @param t Receives the distance to the hitpoint if one was found
+     * @return @c true if an intersection was found.
+     */
+    bool intersectDistance(const Ray &ray, float tMax, float &t) const {
         // if the ray travels in the xy-plane, we report no intersection
         // (we ignore the edge case - pun intended - that the ray might have
         // infinite intersections with the rectangle)
@@ -46,37 +72,66 @@ public:
 
         // ray.origin.z + t * ray.direction.z = 0
         // <=> t = -ray.origin.z / ray.direction.z
-        const float t = -ray.origin.z() / ray.direction.z();
+        t = -ray.origin.z() / ray.direction.z();
 
         // note that we never report an intersection closer than Epsilon (to
-        // avoid self-intersections)! we also do not update the intersection if
-        // a closer intersection already exists (i.e., its.t is lower than our
+        // avoid self-intersections)! we also do not report an intersection if
+        // a closer intersection already exists (i.e., tMax is lower than our
         // own t)
-        if (t < Epsilon || t > its.t)
+        if (t < Epsilon || t > tMax)
             return false;
 
-        // compute the hitpoint
-        const Point position = ray(t);
         // we have intersected an infinite plane at z=0; now dismiss anything
         // outside of the [-1,-1,0]..[+1,+1,0] domain.
-        if (std::abs(position.x()) > 1 || std::abs(position.y()) > 1)
+        const Point position = ray(t);
+        return std::abs(position.x()) <= 1 && std::abs(position.y()) <= 1;
+    }
+
+public:
+    Rectangle(const Properties &properties) {
+        m_improved = properties.get<bool>("improved", true);
+    }
+
+    bool intersect(const Ray &ray, Intersection &its,
+                   Sampler &rng) const override {
+        PROFILE("Rectangle")
+
+        float t;
+        if (!intersectDistance(ray, its.t, t))
             return false;
 
         // we have determined there was an intersection! we are now free to
         // change the intersection object and return true.
         its.t = t;
         populate(its,
-                 position); // compute the shading frame, texture coordinates
-                            // and area pdf (same as sampleArea)
+                 ray(t)); // compute the shading frame, texture coordinates
+                          // and area pdf (same as sampleArea)
+        if (m_improved && its.needsPdf) {
+            // the density of sampling the hitpoint from the origin of the ray
+            const SphericalRectangle rectangle = seenFrom(ray.origin);
+            if (samplesSolidAngle(rectangle))
+                its.pdf = solidAnglePdf(rectangle, its.position, ray.origin);
+        }
         return true;
     }
 
+    bool occluded(const Ray &ray, float tMax, Sampler &rng) const override {
+        PROFILE("Rectangle")
+
+        float t;
+        return intersectDistance(ray, tMax, t);
+    }
+
     Bounds getBoundingBox() const override {
         return Bounds(Point{ -1, -1, 0 }, Point{ +1, +1, 0 });
     }
 
     Point getCentroid() const override { return Point(0); }
 
+    DirectionCone getNormalCone() const override {
+        return { Vector(0, 0, 1), 1 };
+    }
+
     AreaSample sampleArea(Sampler &rng) const override {
         Point2 rnd = rng.next2D(); // sample a random point in [0,0]..[1,1]
         Point position{
@@ -90,6 +145,24 @@ public:
         return sample;
     }
 
+    AreaSample sampleArea(Sampler &rng,
+                          const SurfaceEvent &ref) const override {
+        if (!m_improved)
+            return sampleArea(rng);
+
+        // points close to the rectangle see it under a large solid angle,
+        // which is sampled uniformly (unless it is too small or too large to
+        // do so robustly)
+        const SphericalRectangle rectangle = seenFrom(ref.position);
+        if (!samplesSolidAngle(rectangle))
+            return sampleArea(rng);
+
+        AreaSample sample;
+        populate(sample, rectangle.sample(rng.next2D()));
+        sample.pdf = solidAnglePdf(rectangle, sample.position, ref.position);
+        return sample;
+    }
+
     std::string toString() const override { return "Rectangle[]"; }
 };
 
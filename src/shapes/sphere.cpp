@@ -56,10 +56,9 @@ public:
         m_improved = properties.get<bool>("improved", true); // Defaults to true
     }
 
-    bool intersect(const Ray &ray, Intersection &its,
-                   Sampler &rng) const override {
-        PROFILE("Sphere")
-
+    /// @brief Computes the closest distance along the ray at which the sphere
+    /// is hit, if it lies within [Epsilon, tMax].
+    bool intersectDistance(const Ray &ray, float tMax, float &t_hit) const {
         const float radius = 1.0f;
 
         Vector orig_centered = ray.origin - getCentroid();
@@ -90,17 +89,28 @@ public:
         
         // Check for nearest intersection
 
-        if (t0 > its.t || t1 < Epsilon)
+        if (t0 > tMax || t1 < Epsilon)
             return false; // Values are out of shape bounds
         
-        float t_hit = t0;
+        t_hit = t0;
 
         if (t_hit < Epsilon){
             t_hit = t1;
-            if (t_hit > its.t)
+            if (t_hit > tMax)
                 return false;
         }
 
+        return true;
+    }
+
+    bool intersect(const Ray &ray, Intersection &its,
+                   Sampler &rng) const override {
+        PROFILE("Sphere")
+
+        float t_hit;
+        if (!intersectDistance(ray, its.t, t_hit))
+            return false;
+
         Point position = ray(t_hit);
         its.t = t_hit;
         populate(its,
@@ -111,6 +121,13 @@ public:
         return true;
     }
 
+    bool occluded(const Ray &ray, float tMax, Sampler &rng) const override {
+        PROFILE("Sphere")
+
+        float t_hit;
+        return intersectDistance(ray, tMax, t_hit);
+    }
+
     Bounds getBoundingBox() const override {
         return Bounds(Point(-1.0f), Point(1.0f));
     }
@@ -0,0 +1,184 @@
+/**
+ * @brief Sampling of points on shapes uniformly by the solid angle they cover
+ * as seen from a reference point, which is used for area lights that are
+ * close to the points they illuminate.
+ * @file spherical.hpp
+ */
+
+#pragma once
+
+#include <lightwave/math.hpp>
+
+#include <optional>
+
+namespace lightwave {
+
+/// @brief Sampling by solid angle is only numerically robust for solid angles
+/// within this range, outside of which shapes sample by area instead.
+constexpr float MinSphericalSampleArea = 3e-4f;
+/// @copydoc MinSphericalSampleArea
+constexpr float MaxSphericalSampleArea = 6.22f;
+
+/// @brief Returns the solid angle of a triangle as seen from a point (van
+/// Oosterom and Strackee, "The Solid Angle of a Plane Triangle", 1983).
+inline float sphericalTriangleArea(const Point &p0, const Point &p1,
+                                   const Point &p2, const Point &origin) {
+    const Vector a = (p0 - origin).normalized();
+    const Vector b = (p1 - origin).normalized();
+    const Vector c = (p2 - origin).normalized();
+    return abs(2 * std::atan2(a.dot(b.cross(c)),
+                              1 + a.dot(b) + a.dot(c) + b.dot(c)));
+}
+
+/**
+ * @brief Samples a direction uniformly within the solid angle of a triangle as
+ * seen from a point, and returns where it hits the triangle as barycentric
+ * coordinates (see @ref interpolateBarycentric ). Follows Arvo, "Stratified
+ * Sampling of Spherical Triangles" (1995), as implemented by pbrt-v4.
+ * @returns Nothing if the triangle degenerates to a line as seen from the
+ * point.
+ */
+inline std::optional<Vector2> sampleSphericalTriangle(const Point &p0,
+                                                      const Point &p1,
+                                                      const Point &p2,
+                                                      const Point &origin,
+                                                      const Point2 &sample) {
+    const Vector a = (p0 - origin).normalized();
+    const Vector b = (p1 - origin).normalized();
+    const Vector c = (p2 - origin).normalized();
+
+    // the normals of the great circles through the edges
+    Vector nAB = a.cross(b), nBC = b.cross(c), nCA = c.cross(a);
+    if (nAB.lengthSquared() == 0 || nBC.lengthSquared() == 0 ||
+        nCA.lengthSquared() == 0)
+        return std::nullopt;
+    nAB = nAB.normalized();
+    nBC = nBC.normalized();
+    nCA = nCA.normalized();
+
+    // the interior angles at the vertices, whose excess over Pi is the area
+    const float alpha = safe_acos(-nAB.dot(nCA));
+    const float beta  = safe_acos(-nBC.dot(nAB));
+    const float gamma = safe_acos(-nCA.dot(nBC));
+
+    // pick the area of the sub-triangle a, b, c' that contains the sample,
+    // and find the point c' on the arc from a to c that yields this area
+    const float subArea  = Pi + sample.x() * (alpha + beta + gamma - Pi);
+    const float cosAlpha = std::cos(alpha);
+    const float sinAlpha = std::sin(alpha);
+    const float sinPhi = std::sin(subArea) * cosAlpha - std::cos(subArea) * sinAlpha;
+    const float cosPhi = std::cos(subArea) * cosAlpha + std::sin(subArea) * sinAlpha;
+    const float k1     = cosPhi + cosAlpha;
+    const float k2     = sinPhi - sinAlpha * a.dot(b);
+    const float cosBp  = clamp((k2 + (k2 * cosPhi - k1 * sinPhi) * cosAlpha) /
+                                  ((k2 * sinPhi + k1 * cosPhi) * sinAlpha),
+                              -1.f,
+                              1.f);
+    const float sinBp  = safe_sqrt(1 - sqr(cosBp));
+    const Vector cp    = cosBp * a + sinBp * (c - c.dot(a) * a).normalized();
+
+    // sample the arc from b to c'
+    const float cosTheta = 1 - sample.y() * (1 - cp.dot(b));
+    const float sinTheta = safe_sqrt(1 - sqr(cosTheta));
+    const Vector w = cosTheta * b + sinTheta * (cp - cp.dot(b) * b).normalized();
+
+    // intersect the sampled direction with the plane of the triangle
+    const Vector e1     = p1 - p0;
+    const Vector e2     = p2 - p0;
+    const Vector s1     = w.cross(e2);
+    const float divisor = s1.dot(e1);
+    if (divisor == 0)
+        return Vector2(1.f / 3);
+    const Vector s = origin - p0;
+    float b1       = clamp(s.dot(s1) / divisor, 0.f, 1.f);
+    float b2       = clamp(w.dot(s.cross(e1)) / divisor, 0.f, 1.f);
+    if (b1 + b2 > 1) {
+        const float sum = b1 + b2;
+        b1 /= sum;
+        b2 /= sum;
+    }
+    return Vector2(b1, b2);
+}
+
+/**
+ * @brief An axis-aligned rectangle in the xy-plane, as seen from a point.
+ * Directions within its solid angle are sampled uniformly, following Urena
+ * et al., "An Area-Preserving Parametrization for Spherical Rectangles"
+ * (2013), as implemented by pbrt-v4.
+ */
+class SphericalRectangle {
+    /// @brief The point the rectangle is seen from.
+    Point m_origin;
+    /// @brief The rectangle relative to the origin, mirrored such that it lies
+    /// below the origin (i.e., at negative z).
+    float m_x0, m_x1, m_y0, m_y1, m_z0;
+    /// @brief The z components of the normals of the planes through the
+    /// origin and the lower and upper edge along x.
+    float m_b0, m_b1;
+    /// @brief The interior angles at the four corners.
+    float m_gamma[4];
+    float m_solidAngle;
+
+    /// @brief The largest float below one.
+    static constexpr float OneMinusEpsilon = 0x1.fffffep-1f;
+
+public:
+    SphericalRectangle(const Point &origin, const Point2 &min,
+                       const Point2 &max)
+        : m_origin(origin) {
+        m_x0 = min.x() - origin.x();
+        m_x1 = max.x() - origin.x();
+        m_y0 = min.y() - origin.y();
+        m_y1 = max.y() - origin.y();
+        m_z0 = -abs(origin.z());
+        if (m_z0 == 0) {
+            // the rectangle degenerates to a line
+            m_solidAngle = 0;
+            return;
+        }
+
+        // the normals of the planes through the origin and the edges
+        const Vector v00(m_x0, m_y0, m_z0), v01(m_x0, m_y1, m_z0);
+        const Vector v10(m_x1, m_y0, m_z0), v11(m_x1, m_y1, m_z0);
+        const Vector n[4] = { v00.cross(v10).normalized(),
+                              v10.cross(v11).normalized(),
+                              v11.cross(v01).normalized(),
+                              v01.cross(v00).normalized() };
+        m_b0 = n[0].z();
+        m_b1 = n[2].z();
+
+        for (int i = 0; i < 4; i++)
+            m_gamma[i] = safe_acos(-n[i].dot(n[(i + 1) % 4]));
+        m_solidAngle = std::max(
+            m_gamma[0] + m_gamma[1] + m_gamma[2] + m_gamma[3] - 2 * Pi, 0.f);
+    }
+
+    /// @brief Returns the solid angle covered by the rectangle.
+    float solidAngle() const { return m_solidAngle; }
+
+    /// @brief Returns the point on the rectangle of a direction sampled
+    /// uniformly within its solid angle.
+    Point sample(const Point2 &sample) const {
+        // pick the x coordinate such that the part of the solid angle below
+        // it is proportional to the sample
+        const float au = sample.x() * (m_gamma[0] + m_gamma[1] - 2 * Pi) +
+                         (sample.x() - 1) * (m_gamma[2] + m_gamma[3]);
+        const float fu = (std::cos(au) * m_b0 - m_b1) / std::sin(au);
+        const float cu = clamp(std::copysign(1 / std::sqrt(sqr(fu) + sqr(m_b0)), fu),
+                               -OneMinusEpsilon,
+                               OneMinusEpsilon);
+        const float xu = clamp(-(cu * m_z0) / safe_sqrt(1 - sqr(cu)), m_x0, m_x1);
+
+        // pick the y coordinate uniformly in solid angle along that x
+        const float distance = std::sqrt(sqr(xu) + sqr(m_z0));
+        const float h0 = m_y0 / std::sqrt(sqr(distance) + sqr(m_y0));
+        const float h1 = m_y1 / std::sqrt(sqr(distance) + sqr(m_y1));
+        const float hv = h0 + sample.y() * (h1 - h0);
+        const float yv = sqr(hv) < 1 - 1e-6f
+                             ? clamp(hv * distance / std::sqrt(1 - sqr(hv)), m_y0, m_y1)
+                             : m_y1;
+        return { m_origin.x() + xu, m_origin.y() + yv, 0 };
+    }
+};
+
+} // namespace lightwave
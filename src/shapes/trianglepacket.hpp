@@ -0,0 +1,225 @@
+#pragma once
+
+#include <lightwave/core.hpp>
+#include <lightwave/math.hpp>
+
+#include <bit>
+
+#ifdef LW_SIMD_SSE
+#include <immintrin.h>
+#endif
+
+namespace lightwave {
+
+/**
+ * @brief The data needed to test a single triangle for intersection, i.e., the
+ * first vertex and the two edges starting at it.
+ */
+struct PrecomputedTriangle {
+    /// @brief The position of the first vertex.
+    Point v0;
+    /// @brief The edge from the first to the second vertex.
+    Vector edge0;
+    /// @brief The edge from the first to the third vertex.
+    Vector edge1;
+
+    PrecomputedTriangle() = default;
+    PrecomputedTriangle(const Point &p0, const Point &p1, const Point &p2)
+        : v0(p0), edge0(p1 - p0), edge1(p2 - p0) {}
+
+    /**
+     * @brief Möller–Trumbore test of the triangle against a ray. Only computes
+     * the distance and barycentric coordinates, so that occlusion tests and
+     * rejected candidates do not pay for any surface attributes.
+     */
+    bool intersect(const Ray &ray, float tMax, float &t,
+                   Vector2 &barycentric) const {
+        const Vector p_vec = ray.direction.cross(edge1);
+        const float det    = edge0.dot(p_vec);
+
+        // also rejects degenerate triangles
+        if (fabs(det) < 1e-6) return false; // Reducing epsilon made it work for bunny (?)
+
+        const float inv_det = 1 / det;
+
+        const Vector t_vec = ray.origin - v0;
+        const float u      = t_vec.dot(p_vec) * inv_det;
+        if (u < 0 || u > 1) return false;
+
+        const Vector q_vec = t_vec.cross(edge0);
+        const float v      = ray.direction.dot(q_vec) * inv_det;
+        if (v < 0 || u + v > 1) return false;
+
+        t = edge1.dot(q_vec) * inv_det;
+        if (t < Epsilon || t > tMax) return false;
+
+        barycentric = Vector2(u, v);
+        return true;
+    }
+};
+
+/**
+ * @brief A packet of triangles stored as structure of arrays, which allows
+ * intersecting a ray with all of them at once using SIMD instructions.
+ * @note Unused lanes hold degenerate triangles, which are never hit.
+ */
+struct alignas(16) TrianglePacket {
+    /// @brief The number of triangles per packet.
+    static constexpr int Width = 4;
+
+    /// @brief The first vertices, indexed by axis and lane.
+    float v0[3][Width];
+    /// @brief The edges from the first to the second vertices.
+    float edge0[3][Width];
+    /// @brief The edges from the first to the third vertices.
+    float edge1[3][Width];
+    /// @brief The primitive index of each triangle, or -1 for unused lanes.
+    int primitiveIndices[Width];
+
+    TrianglePacket() {
+        for (int lane = 0; lane < Width; lane++)
+            set(lane, PrecomputedTriangle(Point(0), Point(0), Point(0)), -1);
+    }
+
+    /// @brief Stores a triangle in the given lane.
+    void set(int lane, const PrecomputedTriangle &triangle,
+             int primitiveIndex) {
+        for (int axis = 0; axis < 3; axis++) {
+            v0[axis][lane]    = triangle.v0[axis];
+            edge0[axis][lane] = triangle.edge0[axis];
+            edge1[axis][lane] = triangle.edge1[axis];
+        }
+        primitiveIndices[lane] = primitiveIndex;
+    }
+
+    /**
+     * @brief Tests all triangles of the packet against a ray.
+     * @param t,u,v Receive the distance and barycentric coordinates of each
+     * lane (only meaningful for lanes that are hit).
+     * @return A bit mask of the lanes that are hit closer than @c tMax .
+     */
+    int test(const Ray &ray, float tMax, float t[Width], float u[Width],
+             float v[Width]) const {
+#ifdef LW_SIMD_SSE
+        const __m128 dx = _mm_set1_ps(ray.direction.x());
+        const __m128 dy = _mm_set1_ps(ray.direction.y());
+        const __m128 dz = _mm_set1_ps(ray.direction.z());
+        const __m128 e0x = _mm_load_ps(edge0[0]);
+        const __m128 e0y = _mm_load_ps(edge0[1]);
+        const __m128 e0z = _mm_load_ps(edge0[2]);
+        const __m128 e1x = _mm_load_ps(edge1[0]);
+        const __m128 e1y = _mm_load_ps(edge1[1]);
+        const __m128 e1z = _mm_load_ps(edge1[2]);
+
+        // p = direction x edge1
+        const __m128 px =
+            _mm_sub_ps(_mm_mul_ps(dy, e1z), _mm_mul_ps(dz, e1y));
+        const __m128 py =
+            _mm_sub_ps(_mm_mul_ps(dz, e1x), _mm_mul_ps(dx, e1z));
+        const __m128 pz =
+            _mm_sub_ps(_mm_mul_ps(dx, e1y), _mm_mul_ps(dy, e1x));
+        const __m128 det = dot(e0x, e0y, e0z, px, py, pz);
+        const __m128 invDet = _mm_div_ps(_mm_set1_ps(1), det);
+
+        // s = origin - v0
+        const __m128 sx = _mm_sub_ps(_mm_set1_ps(ray.origin.x()),
+                                     _mm_load_ps(v0[0]));
+        const __m128 sy = _mm_sub_ps(_mm_set1_ps(ray.origin.y()),
+                                     _mm_load_ps(v0[1]));
+        const __m128 sz = _mm_sub_ps(_mm_set1_ps(ray.origin.z()),
+                                     _mm_load_ps(v0[2]));
+        const __m128 uu = _mm_mul_ps(dot(sx, sy, sz, px, py, pz), invDet);
+
+        // q = s x edge0
+        const __m128 qx =
+            _mm_sub_ps(_mm_mul_ps(sy, e0z), _mm_mul_ps(sz, e0y));
+        const __m128 qy =
+            _mm_sub_ps(_mm_mul_ps(sz, e0x), _mm_mul_ps(sx, e0z));
+        const __m128 qz =
+            _mm_sub_ps(_mm_mul_ps(sx, e0y), _mm_mul_ps(sy, e0x));
+        const __m128 vv = _mm_mul_ps(dot(dx, dy, dz, qx, qy, qz), invDet);
+        const __m128 tt = _mm_mul_ps(dot(e1x, e1y, e1z, qx, qy, qz), invDet);
+
+        // the same conditions as the scalar test, phrased so that NaNs fail
+        const __m128 absDet = _mm_andnot_ps(_mm_set1_ps(-0.f), det);
+        const __m128 zero   = _mm_setzero_ps();
+        const __m128 one    = _mm_set1_ps(1);
+        __m128 hit = _mm_cmpge_ps(absDet, _mm_set1_ps(1e-6f));
+        hit = _mm_and_ps(hit, _mm_cmpge_ps(uu, zero));
+        hit = _mm_and_ps(hit, _mm_cmple_ps(uu, one));
+        hit = _mm_and_ps(hit, _mm_cmpge_ps(vv, zero));
+        hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_add_ps(uu, vv), one));
+        hit = _mm_and_ps(hit, _mm_cmpge_ps(tt, _mm_set1_ps(Epsilon)));
+        hit = _mm_and_ps(hit, _mm_cmple_ps(tt, _mm_set1_ps(tMax)));
+
+        _mm_storeu_ps(t, tt);
+        _mm_storeu_ps(u, uu);
+        _mm_storeu_ps(v, vv);
+        return _mm_movemask_ps(hit);
+#else
+        int hitMask = 0;
+        for (int lane = 0; lane < Width; lane++) {
+            Vector2 barycentric;
+            if (triangle(lane).intersect(ray, tMax, t[lane], barycentric)) {
+                u[lane] = barycentric.x();
+                v[lane] = barycentric.y();
+                hitMask |= 1 << lane;
+            }
+        }
+        return hitMask;
+#endif
+    }
+
+    /**
+     * @brief Finds the closest triangle of the packet that is hit closer than
+     * @c tMax .
+     * @return The lane of the closest hit, or -1 if no triangle is hit.
+     */
+    int intersect(const Ray &ray, float tMax, float &t,
+                  Vector2 &barycentric) const {
+        float ts[Width], us[Width], vs[Width];
+        int hitMask = test(ray, tMax, ts, us, vs);
+
+        int closest = -1;
+        for (; hitMask; hitMask &= hitMask - 1) {
+            const int lane = std::countr_zero(unsigned(hitMask));
+            if (closest == -1 || ts[lane] <= ts[closest])
+                closest = lane;
+        }
+        if (closest != -1) {
+            t           = ts[closest];
+            barycentric = Vector2(us[closest], vs[closest]);
+        }
+        return closest;
+    }
+
+    /// @brief Tests whether any triangle of the packet is hit closer than @c
+    /// tMax .
+    bool occluded(const Ray &ray, float tMax) const {
+        float ts[Width], us[Width], vs[Width];
+        return test(ray, tMax, ts, us, vs) != 0;
+    }
+
+    /// @brief Returns the triangle stored in a given lane.
+    PrecomputedTriangle triangle(int lane) const {
+        PrecomputedTriangle result;
+        for (int axis = 0; axis < 3; axis++) {
+            result.v0[axis]    = v0[axis][lane];
+            result.edge0[axis] = edge0[axis][lane];
+            result.edge1[axis] = edge1[axis][lane];
+        }
+        return result;
+    }
+
+private:
+#ifdef LW_SIMD_SSE
+    static __m128 dot(__m128 ax, __m128 ay, __m128 az, __m128 bx, __m128 by,
+                      __m128 bz) {
+        return _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)),
+            _mm_mul_ps(az, bz));
+    }
+#endif
+};
+
+} // namespace lightwave
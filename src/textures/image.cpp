@@ -84,6 +84,8 @@ public:
         }
     }
 
+    Point2i resolution() const override { return m_image->resolution(); }
+
     std::string toString() const override {
         return tfm::format(
             "ImageTexture[\n"
@@ -0,0 +1,111 @@
+#include <catch_amalgamated.hpp>
+#include <lightwave/properties.hpp>
+#include <lightwave/registry.hpp>
+#include <lightwave/sampler.hpp>
+#include <lightwave/warp.hpp>
+#include <core/lightbvh.hpp>
+
+#include <map>
+
+using namespace lightwave;
+
+/// @brief A light that only reports the given bounds.
+class BoundedLight : public Light {
+    std::optional<LightBounds> m_bounds;
+
+public:
+    BoundedLight(const std::optional<LightBounds> &bounds)
+        : Light(Properties()), m_bounds(bounds) {}
+
+    DirectLightSample sampleDirect(const Point &origin,
+                                   Sampler &rng) const override {
+        return DirectLightSample::invalid();
+    }
+
+    float power(const Bounds &sceneBounds) const override {
+        return m_bounds ? m_bounds->power : 1;
+    }
+
+    std::optional<LightBounds> bounds() const override { return m_bounds; }
+
+    std::string toString() const override { return "BoundedLight[]"; }
+};
+
+// clang-format off
+
+TEST_CASE( "Light BVH picks lights with the probabilities it reports", "[lightbvh]" ) {
+    const auto rng = std::static_pointer_cast<Sampler>(
+        Registry::create("sampler", "independent", Properties()));
+    rng->seed(0);
+    auto randomPoint = [&]() {
+        return Point(10 * rng->next() - 5, 10 * rng->next() - 5, 10 * rng->next() - 5);
+    };
+    auto randomDirection = [&]() {
+        return squareToUniformSphere(rng->next2D());
+    };
+
+    // point lights and one-sided rectangular lights of varying power, and a
+    // light without bounds
+    std::vector<ref<Light>> lights;
+    for (int i = 0; i < 100; i++) {
+        const Point position = randomPoint();
+        LightBounds bounds = {
+            .bounds           = Bounds(position, position),
+            .normals          = DirectionCone::entireSphere(),
+            .cosThetaEmission = 0,
+            .power            = 0.1f + rng->next(),
+        };
+        if (i % 2) {
+            bounds.bounds.extend(position + Vector(0.5f, 0.5f, 0));
+            bounds.normals = { randomDirection(), 1 };
+        }
+        lights.push_back(std::make_shared<BoundedLight>(bounds));
+    }
+    lights.push_back(std::make_shared<BoundedLight>(std::nullopt));
+    for (int index = 0; index < int(lights.size()); index++)
+        lights[index]->setIndex(index);
+    const LightBVH bvh{ lights };
+    REQUIRE( bvh.hasLights() );
+
+    for (int query = 0; query < 20; query++) {
+        const Point position = randomPoint();
+        const Vector normal  = randomDirection();
+
+        constexpr int SampleCount = 100000;
+        std::map<const Light *, int> counts;
+        for (int i = 0; i < SampleCount; i++) {
+            const LightSample sample = bvh.sample(position, normal, (i + 0.5f) / SampleCount);
+            if (!sample)
+                continue;
+            REQUIRE( sample.probability == Catch::Approx(bvh.probability(sample.light, position, normal)) );
+            counts[sample.light]++;
+        }
+
+        float totalProbability = 0;
+        for (const auto &light : lights) {
+            const float probability = bvh.probability(light.get(), position, normal);
+            totalProbability += probability;
+            const float frequency = float(counts[light.get()]) / SampleCount;
+            REQUIRE( frequency == Catch::Approx(probability).margin(1e-3) );
+        }
+        // picking fails where no light within a subtree can contribute
+        REQUIRE( totalProbability <= Catch::Approx(1) );
+        REQUIRE( totalProbability > 0.9f );
+    }
+}
+
+TEST_CASE( "Light BVH skips lights that face away", "[lightbvh]" ) {
+    LightBounds bounds = {
+        .bounds           = Bounds(Point(-1, -1, 0), Point(1, 1, 0)),
+        .normals          = { Vector(0, 0, 1), 1 },
+        .cosThetaEmission = 0,
+        .power            = 1,
+    };
+    const auto light = std::make_shared<BoundedLight>(bounds);
+    light->setIndex(0);
+    const LightBVH bvh{ { light } };
+
+    REQUIRE( bvh.probability(nullptr, Point(0, 0, 1), Vector(0)) == 0 );
+    REQUIRE( bvh.sample(Point(0, 0, 5), Vector(0, 0, -1), 0.5f) );
+    REQUIRE( !bvh.sample(Point(0, 0, -5), Vector(0, 0, 1), 0.5f) );
+}
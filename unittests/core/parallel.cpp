@@ -0,0 +1,53 @@
+#include <catch_amalgamated.hpp>
+#include <lightwave/math.hpp>
+#include <lightwave/iterators.hpp>
+#include <lightwave/parallel.hpp>
+
+using namespace lightwave;
+
+TEST_CASE( "Thread pool", "[parallel]" ) {
+    SECTION( "Every item is processed exactly once" ) {
+        std::vector<std::atomic<int>> counts(10000);
+        for_each_parallel(Range(0, int(counts.size())),
+                          [&](int index) { counts[index]++; });
+        for (const auto &count : counts)
+            REQUIRE( count == 1 );
+    }
+
+    SECTION( "Parallel loops can be nested" ) {
+        std::atomic<int> sum = 0;
+        for_each_parallel(Range(0, 64), [&](int) {
+            for_each_parallel(Range(0, 64), [&](int index) { sum += index; });
+        });
+        REQUIRE( sum == 64 * (63 * 64 / 2) );
+    }
+
+    SECTION( "Workers help with other loops while waiting for nested ones" ) {
+        ThreadPool pool{ 4 };
+        std::atomic<int> sum = 0;
+        pool.parallelFor(16, [&](int) {
+            pool.parallelFor(16, [&](int) {
+                pool.parallelFor(16, [&](int index) { sum += index; });
+            });
+        });
+        REQUIRE( sum == 16 * 16 * (15 * 16 / 2) );
+    }
+
+    SECTION( "Exceptions are passed to the caller" ) {
+        REQUIRE_THROWS_AS(for_each_parallel(Range(0, 100),
+                                            [](int index) {
+                                                if (index == 42)
+                                                    throw std::runtime_error(
+                                                        "failed");
+                                            }),
+                          std::runtime_error);
+    }
+
+    SECTION( "Results of asynchronous tasks are returned" ) {
+        std::vector<std::future<int>> futures;
+        for (int i = 0; i < 100; i++)
+            futures.push_back(ThreadPool::global().async([i]() { return i * i; }));
+        for (int i = 0; i < 100; i++)
+            REQUIRE( futures[i].get() == i * i );
+    }
+}
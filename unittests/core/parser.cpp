@@ -0,0 +1,67 @@
+#include <catch_amalgamated.hpp>
+#include <lightwave/instance.hpp>
+#include <lightwave/light.hpp>
+#include <lightwave/properties.hpp>
+#include <lightwave/registry.hpp>
+#include <lightwave/sampler.hpp>
+#include <core/parser.hpp>
+
+#include <fstream>
+
+using namespace lightwave;
+
+// clang-format off
+
+TEST_CASE( "Reloading a scene only reuses objects without instances", "[parser]" ) {
+    const auto path = std::filesystem::temp_directory_path() / "neotracer_reload_test.xml";
+    {
+        std::ofstream file(path);
+        file << R"(
+            <bsdf type="diffuse">
+                <texture name="albedo" type="constant" value="0.5"/>
+            </bsdf>
+            <shape type="group">
+                <instance id="lamp">
+                    <shape type="rectangle"/>
+                    <transform>
+                        <translate z="1"/>
+                    </transform>
+                    <emission type="lambertian">
+                        <texture name="emission" type="constant" value="1"/>
+                    </emission>
+                </instance>
+            </shape>
+            <light type="area">
+                <ref id="lamp"/>
+            </light>
+        )";
+    }
+
+    const auto rng = std::static_pointer_cast<Sampler>(
+        Registry::create("sampler", "independent", Properties()));
+    rng->seed(0);
+
+    // the instance within the group must belong to the light of that load
+    auto check = [&](const std::vector<ref<Object>> &objects) {
+        REQUIRE( objects.size() == 3 );
+        const auto group = std::dynamic_pointer_cast<Shape>(objects[1]);
+        const auto light = std::dynamic_pointer_cast<Light>(objects[2]);
+        REQUIRE( group );
+        REQUIRE( light );
+
+        Intersection its;
+        REQUIRE( group->intersect(Ray(Point(0, 0, -1), Vector(0, 0, 1)), its, *rng) );
+        REQUIRE( its.instance->light() == light.get() );
+    };
+
+    const SceneParser first(path);
+    check(first.objects());
+
+    const SceneParser second(path, first.objectCache());
+    check(second.objects());
+
+    REQUIRE( second.objects()[0] == first.objects()[0] );
+    REQUIRE( second.objects()[1] != first.objects()[1] );
+
+    std::filesystem::remove(path);
+}
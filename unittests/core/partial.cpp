@@ -0,0 +1,59 @@
+#include <catch_amalgamated.hpp>
+#include <core/partial.hpp>
+
+using namespace lightwave;
+
+// clang-format off
+
+/// @brief A block whose pixels have all been summed to the given value.
+static PartialRender::Block block(const Bounds2i &bounds, int firstSample, int sampleCount, float sum) {
+    return { bounds, firstSample, sampleCount, std::vector<Color>(bounds.diagonal().product(), Color(sum)) };
+}
+
+TEST_CASE( "Partial renders are merged into the image", "[partial]" ) {
+    const Point2i resolution(4, 2);
+    const Bounds2i left(Point2i(0, 0), Point2i(2, 2));
+    const Bounds2i right(Point2i(2, 0), Point2i(4, 2));
+
+    SECTION( "blocks and sample ranges are combined" ) {
+        // the left half is split by samples, the right half is not
+        const std::vector<PartialRender> renders = {
+            { resolution, { block(left, 0, 4, 4), block(right, 0, 8, 16) } },
+            { resolution, { block(left, 4, 4, 12) } },
+        };
+        const Image image = mergePartialRenders(renders);
+        REQUIRE( image.resolution() == resolution );
+        REQUIRE( image(Point2i(1, 1)).r() == 2 );
+        REQUIRE( image(Point2i(2, 0)).r() == 2 );
+    }
+
+    SECTION( "blocks outside of the image are rejected" ) {
+        const std::vector<PartialRender> renders = {
+            { resolution, { block(Bounds2i(Point2i(2, 0), Point2i(5, 2)), 0, 4, 1) } },
+        };
+        REQUIRE_THROWS( mergePartialRenders(renders) );
+    }
+
+    SECTION( "blocks whose size does not match their bounds are rejected" ) {
+        auto truncated = block(left, 0, 4, 1);
+        truncated.sums.pop_back();
+        const std::vector<PartialRender> renders = { { resolution, { truncated } } };
+        REQUIRE_THROWS( mergePartialRenders(renders) );
+    }
+
+    SECTION( "blocks that share samples of a pixel are rejected" ) {
+        const std::vector<PartialRender> renders = {
+            { resolution, { block(left, 0, 4, 1) } },
+            { resolution, { block(Bounds2i(Point2i(1, 0), Point2i(3, 2)), 2, 4, 1) } },
+        };
+        REQUIRE_THROWS( mergePartialRenders(renders) );
+    }
+
+    SECTION( "renders of different resolutions are rejected" ) {
+        const std::vector<PartialRender> renders = {
+            { resolution, { block(left, 0, 4, 1) } },
+            { Point2i(4, 4), { block(right, 0, 4, 1) } },
+        };
+        REQUIRE_THROWS( mergePartialRenders(renders) );
+    }
+}
@@ -0,0 +1,41 @@
+#include <catch_amalgamated.hpp>
+#include <lightwave/warp.hpp>
+
+using namespace lightwave;
+
+// clang-format off
+
+TEST_CASE( "Alias tables sample proportionally to their weights", "[warp]" ) {
+    const std::vector<float> weights = { 1, 0, 3, 0.5f, 10, 0, 2.5f };
+    const AliasTable table{ weights };
+    REQUIRE( table.size() == int(weights.size()) );
+
+    float totalWeight = 0;
+    for (float weight : weights)
+        totalWeight += weight;
+
+    SECTION( "Probabilities are the normalized weights" ) {
+        for (int index = 0; index < table.size(); index++)
+            REQUIRE( table.probability(index) == Catch::Approx(weights[index] / totalWeight) );
+    }
+
+    SECTION( "A grid of samples hits each index as often as expected" ) {
+        constexpr int Resolution = 1000;
+        std::vector<int> counts(weights.size(), 0);
+        for (int y = 0; y < Resolution; y++)
+            for (int x = 0; x < Resolution; x++)
+                counts[table.sample({ (x + 0.5f) / Resolution, (y + 0.5f) / Resolution })]++;
+
+        for (int index = 0; index < table.size(); index++) {
+            const float frequency = float(counts[index]) / (Resolution * Resolution);
+            REQUIRE( frequency == Catch::Approx(table.probability(index)).margin(1e-3) );
+            if (weights[index] == 0)
+                REQUIRE( counts[index] == 0 );
+        }
+    }
+
+    SECTION( "Tables without positive weights are empty" ) {
+        REQUIRE( AliasTable({ 0, 0 }).empty() );
+        REQUIRE( AliasTable().empty() );
+    }
+}
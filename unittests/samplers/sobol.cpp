@@ -0,0 +1,66 @@
+#include <catch_amalgamated.hpp>
+#include <lightwave/registry.hpp>
+#include <lightwave/sampler.hpp>
+
+using namespace lightwave;
+
+// clang-format off
+
+TEST_CASE( "Sobol samples of a pixel are stratified", "[sobol]" ) {
+    constexpr int Count = 64;
+    Properties props;
+    props.set<int>("count", Count);
+    const auto rng = std::static_pointer_cast<Sampler>(
+        Registry::create("sampler", "sobol", props));
+
+    // camera dimensions and two bounces, with a varying number of numbers
+    // consumed before each bounce
+    std::vector<std::vector<Point2>> points(5);
+    std::vector<std::vector<float>> values(3);
+    for (int sample = 0; sample < Count; sample++) {
+        rng->seed(Point2i(3, 7), sample);
+        points[0].push_back(rng->next2D());
+        values[0].push_back(rng->next());
+        for (int depth = 0; depth < 2; depth++) {
+            rng->startBounce(depth);
+            for (int dim = 0; dim < 2; dim++)
+                points[1 + 2 * depth + dim].push_back(rng->next2D());
+            values[1 + depth].push_back(rng->next());
+            for (int i = 0; i < sample % 3; i++)
+                rng->next();
+        }
+    }
+
+    SECTION( "Each dimension has one sample per stratum" ) {
+        for (const auto &dimension : values) {
+            std::vector<int> strata(Count, 0);
+            for (float value : dimension) {
+                REQUIRE( value >= 0 );
+                REQUIRE( value < 1 );
+                strata[int(value * Count)]++;
+            }
+            REQUIRE( std::count(strata.begin(), strata.end(), 1) == Count );
+        }
+    }
+
+    SECTION( "Pairs of dimensions form (0,6,2)-nets" ) {
+        for (const auto &dimension : points) {
+            for (int xBits = 0; xBits <= 6; xBits++) {
+                const int xCount = 1 << xBits;
+                const int yCount = Count / xCount;
+                std::vector<int> strata(Count, 0);
+                for (const Point2 &p : dimension)
+                    strata[int(p.x() * xCount) * yCount + int(p.y() * yCount)]++;
+                REQUIRE( std::count(strata.begin(), strata.end(), 1) == Count );
+            }
+        }
+    }
+
+    SECTION( "Pixels are scrambled differently" ) {
+        rng->seed(Point2i(3, 7), 0);
+        const Point2 a = rng->next2D();
+        rng->seed(Point2i(4, 7), 0);
+        const Point2 b = rng->next2D();
+        REQUIRE( a != b );
+    }
+}
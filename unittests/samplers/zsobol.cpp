@@ -0,0 +1,55 @@
+#include <catch_amalgamated.hpp>
+#include <lightwave/registry.hpp>
+#include <lightwave/sampler.hpp>
+
+using namespace lightwave;
+
+// clang-format off
+
+TEST_CASE( "ZSobol samples of neighboring pixels are stratified", "[zsobol]" ) {
+    // the samples of all pixels of an aligned 4x4 block (or of 2x2 pixels
+    // with 4 samples each) are the points of one (0,4,2)-net
+    for (const int count : { 1, 4 }) {
+        Properties props;
+        props.set<int>("count", count);
+        const auto rng = std::static_pointer_cast<Sampler>(
+            Registry::create("sampler", "zsobol", props));
+        const int size = count == 1 ? 4 : 2;
+
+        std::vector<std::vector<Point2>> points(2);
+        std::vector<std::vector<float>> values(2);
+        for (int y = 0; y < size; y++) {
+            for (int x = 0; x < size; x++) {
+                for (int sample = 0; sample < count; sample++) {
+                    rng->seed(Point2i(8 + x, 4 + y), sample);
+                    points[0].push_back(rng->next2D());
+                    values[0].push_back(rng->next());
+                    rng->startBounce(0);
+                    values[1].push_back(rng->next());
+                    points[1].push_back(rng->next2D());
+                }
+            }
+        }
+
+        for (const auto &dimension : values) {
+            std::vector<int> strata(16, 0);
+            for (float value : dimension) {
+                REQUIRE( value >= 0 );
+                REQUIRE( value < 1 );
+                strata[int(value * 16)]++;
+            }
+            REQUIRE( std::count(strata.begin(), strata.end(), 1) == 16 );
+        }
+
+        for (const auto &dimension : points) {
+            for (int xBits = 0; xBits <= 4; xBits++) {
+                const int xCount = 1 << xBits;
+                const int yCount = 16 / xCount;
+                std::vector<int> strata(16, 0);
+                for (const Point2 &p : dimension)
+                    strata[int(p.x() * xCount) * yCount + int(p.y() * yCount)]++;
+                REQUIRE( std::count(strata.begin(), strata.end(), 1) == 16 );
+            }
+        }
+    }
+}
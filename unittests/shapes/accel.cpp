@@ -0,0 +1,115 @@
+#include <catch_amalgamated.hpp>
+#include <lightwave/registry.hpp>
+#include <lightwave/sampler.hpp>
+#include <lightwave/warp.hpp>
+#include <shapes/accel.hpp>
+
+using namespace lightwave;
+
+/// @brief A soup of random triangles, used to compare BVH variants.
+class TriangleSoup : public AccelerationStructure {
+    std::vector<std::array<Point, 3>> m_triangles;
+
+    bool hit(int primitiveIndex, const Ray &ray, float tMax, float &t) const {
+        const auto &[p0, p1, p2] = m_triangles[primitiveIndex];
+        const Vector e0          = p1 - p0;
+        const Vector e1          = p2 - p0;
+        const Vector p_vec       = ray.direction.cross(e1);
+        const float det          = e0.dot(p_vec);
+        if (std::abs(det) < 1e-8f)
+            return false;
+        const Vector t_vec = ray.origin - p0;
+        const float u      = t_vec.dot(p_vec) / det;
+        const Vector q_vec = t_vec.cross(e0);
+        const float v      = ray.direction.dot(q_vec) / det;
+        if (u < 0 || v < 0 || u + v > 1)
+            return false;
+        t = e1.dot(q_vec) / det;
+        return t >= Epsilon && t <= tMax;
+    }
+
+protected:
+    int numberOfPrimitives() const override {
+        return int(m_triangles.size());
+    }
+
+    bool intersect(int primitiveIndex, const Ray &ray, Intersection &its,
+                   Sampler &rng) const override {
+        float t;
+        if (!hit(primitiveIndex, ray, its.t, t))
+            return false;
+        its.t = t;
+        return true;
+    }
+
+    bool occluded(int primitiveIndex, const Ray &ray, float tMax,
+                  Sampler &rng) const override {
+        float t;
+        return hit(primitiveIndex, ray, tMax, t);
+    }
+
+    Bounds getBoundingBox(int primitiveIndex) const override {
+        Bounds bounds;
+        for (const Point &p : m_triangles[primitiveIndex])
+            bounds.extend(p);
+        return bounds;
+    }
+
+    Point getCentroid(int primitiveIndex) const override {
+        return getBoundingBox(primitiveIndex).center();
+    }
+
+public:
+    TriangleSoup(const Properties &properties, Sampler &rng, int count)
+        : AccelerationStructure(properties) {
+        for (int i = 0; i < count; i++) {
+            const Point center{ 2 * rng.next() - 1,
+                                2 * rng.next() - 1,
+                                2 * rng.next() - 1 };
+            auto vertex = [&]() {
+                return center + 0.1f * Vector(2 * rng.next() - 1,
+                                              2 * rng.next() - 1,
+                                              2 * rng.next() - 1);
+            };
+            m_triangles.push_back({ vertex(), vertex(), vertex() });
+        }
+        buildAccelerationStructure();
+    }
+
+    AreaSample sampleArea(Sampler &rng) const override { NOT_IMPLEMENTED }
+
+    std::string toString() const override { return "TriangleSoup[]"; }
+};
+
+TEST_CASE( "Wide BVHs match the binary BVH", "[accel]" ) {
+    const Properties props;
+    const auto rng = std::static_pointer_cast<Sampler>(
+        Registry::create("sampler", "independent", props));
+
+    std::vector<std::unique_ptr<Shape>> bvhs;
+    for (const char *accel : { "bvh2", "bvh4", "bvh8" }) {
+        Properties accelProps;
+        accelProps.set<std::string>("accel", accel);
+        rng->seed(0);
+        bvhs.push_back(std::make_unique<TriangleSoup>(accelProps, *rng, 2000));
+    }
+
+    rng->seed(1);
+    for (int i = 0; i < 2000; i++) {
+        const Ray ray{ Point(4 * rng->next() - 2,
+                             4 * rng->next() - 2,
+                             4 * rng->next() - 2),
+                       squareToUniformSphere(rng->next2D()) };
+        const float tMax = 3 * rng->next();
+
+        Intersection expected;
+        const bool expectedHit = bvhs[0]->intersect(ray, expected, *rng);
+        const bool expectedOccluded = bvhs[0]->occluded(ray, tMax, *rng);
+        for (size_t j = 1; j < bvhs.size(); j++) {
+            Intersection its;
+            REQUIRE( bvhs[j]->intersect(ray, its, *rng) == expectedHit );
+            REQUIRE( its.t == expected.t );
+            REQUIRE( bvhs[j]->occluded(ray, tMax, *rng) == expectedOccluded );
+        }
+    }
+}
@@ -0,0 +1,113 @@
+#include <catch_amalgamated.hpp>
+#include <lightwave/properties.hpp>
+#include <lightwave/registry.hpp>
+#include <lightwave/sampler.hpp>
+#include <shapes/spherical.hpp>
+
+using namespace lightwave;
+
+// clang-format off
+
+TEST_CASE( "Spherical triangles are sampled uniformly by solid angle", "[spherical]" ) {
+    const auto rng = std::static_pointer_cast<Sampler>(
+        Registry::create("sampler", "independent", Properties()));
+    rng->seed(0);
+
+    for (int trial = 0; trial < 20; trial++) {
+        const Point origin(0);
+        Point vertices[3];
+        for (auto &vertex : vertices)
+            vertex = Point(4 * rng->next() - 2, 4 * rng->next() - 2, 0.2f + rng->next());
+
+        const float solidAngle = sphericalTriangleArea(vertices[0], vertices[1], vertices[2], origin);
+        if (solidAngle < MinSphericalSampleArea)
+            continue;
+
+        // the triangle is split into four at the midpoints of its edges, which
+        // should be hit in proportion to the solid angles they cover
+        const Vector2 corners[3] = { Vector2(0, 0), Vector2(1, 0), Vector2(0, 1) };
+        const Vector2 midpoints[3] = { Vector2(0.5f, 0), Vector2(0.5f, 0.5f), Vector2(0, 0.5f) };
+        auto position = [&](const Vector2 &barycentric) {
+            return interpolateBarycentric(barycentric, vertices[0], vertices[1], vertices[2]);
+        };
+        auto part = [](const Vector2 &barycentric) {
+            if (barycentric.x() + barycentric.y() < 0.5f)
+                return 0;
+            if (barycentric.x() > 0.5f)
+                return 1;
+            if (barycentric.y() > 0.5f)
+                return 2;
+            return 3;
+        };
+        const float partAngles[4] = {
+            sphericalTriangleArea(position(corners[0]), position(midpoints[0]), position(midpoints[2]), origin),
+            sphericalTriangleArea(position(midpoints[0]), position(corners[1]), position(midpoints[1]), origin),
+            sphericalTriangleArea(position(midpoints[2]), position(midpoints[1]), position(corners[2]), origin),
+            sphericalTriangleArea(position(midpoints[0]), position(midpoints[1]), position(midpoints[2]), origin),
+        };
+
+        constexpr int Resolution = 300;
+        int counts[4] = {};
+        for (int y = 0; y < Resolution; y++) {
+            for (int x = 0; x < Resolution; x++) {
+                const auto barycentric = sampleSphericalTriangle(
+                    vertices[0], vertices[1], vertices[2], origin,
+                    { (x + 0.5f) / Resolution, (y + 0.5f) / Resolution });
+                REQUIRE( barycentric );
+                REQUIRE( barycentric->x() >= 0 );
+                REQUIRE( barycentric->y() >= 0 );
+                REQUIRE( barycentric->x() + barycentric->y() <= Catch::Approx(1) );
+                counts[part(*barycentric)]++;
+            }
+        }
+
+        for (int i = 0; i < 4; i++) {
+            const float frequency = float(counts[i]) / (Resolution * Resolution);
+            REQUIRE( frequency == Catch::Approx(partAngles[i] / solidAngle).margin(5e-3) );
+        }
+    }
+}
+
+TEST_CASE( "Spherical rectangles are sampled uniformly by solid angle", "[spherical]" ) {
+    const auto rng = std::static_pointer_cast<Sampler>(
+        Registry::create("sampler", "independent", Properties()));
+    rng->seed(0);
+
+    const Point2 min(-1, -1), max(+1, +1);
+    for (int trial = 0; trial < 20; trial++) {
+        // points on either side of the rectangle, some of which are close
+        const Point origin(4 * rng->next() - 2, 4 * rng->next() - 2, (trial % 2 ? 1 : -1) * (0.05f + 2 * rng->next()));
+        const SphericalRectangle rectangle{ origin, min, max };
+
+        // the solid angle agrees with that of the two halves of the rectangle
+        const float triangleAngle =
+            sphericalTriangleArea(Point(-1, -1, 0), Point(+1, -1, 0), Point(+1, +1, 0), origin) +
+            sphericalTriangleArea(Point(-1, -1, 0), Point(+1, +1, 0), Point(-1, +1, 0), origin);
+        REQUIRE( rectangle.solidAngle() == Catch::Approx(triangleAngle).epsilon(1e-3) );
+
+        // the quadrants of the rectangle should be hit in proportion to the
+        // solid angles they cover
+        float quadrantAngles[4];
+        for (int i = 0; i < 4; i++) {
+            const Point2 lower(i % 2 ? 0 : -1, i / 2 ? 0 : -1);
+            quadrantAngles[i] = SphericalRectangle(origin, lower, lower + Vector2(1)).solidAngle();
+        }
+
+        constexpr int Resolution = 300;
+        int counts[4] = {};
+        for (int y = 0; y < Resolution; y++) {
+            for (int x = 0; x < Resolution; x++) {
+                const Point position = rectangle.sample({ (x + 0.5f) / Resolution, (y + 0.5f) / Resolution });
+                REQUIRE( position.z() == 0 );
+                REQUIRE( abs(position.x()) <= 1 );
+                REQUIRE( abs(position.y()) <= 1 );
+                counts[(position.x() > 0 ? 1 : 0) + (position.y() > 0 ? 2 : 0)]++;
+            }
+        }
+
+        for (int i = 0; i < 4; i++) {
+            const float frequency = float(counts[i]) / (Resolution * Resolution);
+            REQUIRE( frequency == Catch::Approx(quadrantAngles[i] / rectangle.solidAngle()).margin(5e-3) );
+        }
+    }
+}
@@ -0,0 +1,122 @@
+#include <catch_amalgamated.hpp>
+#include <lightwave/logger.hpp>
+#include <lightwave/registry.hpp>
+#include <lightwave/sampler.hpp>
+#include <lightwave/warp.hpp>
+#include <shapes/trianglepacket.hpp>
+
+using namespace lightwave;
+
+namespace {
+
+/// @brief Random small triangles around the origin, along with the same
+/// triangles grouped into packets.
+struct TriangleSet {
+    std::vector<PrecomputedTriangle> triangles;
+    std::vector<TrianglePacket> packets;
+
+    TriangleSet(Sampler &rng, int count) {
+        auto point = [&](float scale) {
+            return Vector(scale * (2 * rng.next() - 1),
+                          scale * (2 * rng.next() - 1),
+                          scale * (2 * rng.next() - 1));
+        };
+        for (int i = 0; i < count; i++) {
+            const Point center = Point(0) + point(1);
+            triangles.emplace_back(
+                center + point(0.3f), center + point(0.3f), center + point(0.3f));
+            if (i % TrianglePacket::Width == 0)
+                packets.emplace_back();
+            packets.back().set(i % TrianglePacket::Width, triangles.back(), i);
+        }
+    }
+};
+
+Ray randomRay(Sampler &rng) {
+    const Point origin = Point(0) + 3 * squareToUniformSphere(rng.next2D());
+    const Point target{ rng.next() - 0.5f, rng.next() - 0.5f, 0 };
+    return { origin, (target - origin).normalized() };
+}
+
+} // namespace
+
+TEST_CASE( "Triangle packets match the scalar test", "[trianglepacket]" ) {
+    const Properties props;
+    const auto rng = std::static_pointer_cast<Sampler>(
+        Registry::create("sampler", "independent", props));
+    const TriangleSet set{ *rng, 1022 }; // last packet is only partially filled
+
+    for (int i = 0; i < 1000; i++) {
+        const Ray ray    = randomRay(*rng);
+        const float tMax = 5 * rng->next();
+
+        for (const TrianglePacket &packet : set.packets) {
+            float expectedT = tMax;
+            int expectedIndex = -1;
+            for (int lane = 0; lane < TrianglePacket::Width; lane++) {
+                const int index = packet.primitiveIndices[lane];
+                float t;
+                Vector2 barycentric;
+                if (index >= 0 && set.triangles[index].intersect(
+                                      ray, expectedT, t, barycentric)) {
+                    expectedT     = t;
+                    expectedIndex = index;
+                }
+            }
+
+            float t;
+            Vector2 barycentric;
+            const int lane = packet.intersect(ray, tMax, t, barycentric);
+            REQUIRE( (lane == -1 ? -1 : packet.primitiveIndices[lane]) ==
+                     expectedIndex );
+            if (lane != -1)
+                REQUIRE( t == Catch::Approx(expectedT) );
+            REQUIRE( packet.occluded(ray, tMax) == (expectedIndex != -1) );
+        }
+    }
+}
+
+// hidden by default, run using: neotracer -r console "[benchmark]"
+// (a leading option is needed, otherwise the tag is parsed as scene path)
+TEST_CASE( "Triangle packet throughput", "[.][benchmark]" ) {
+    const Properties props;
+    const auto rng = std::static_pointer_cast<Sampler>(
+        Registry::create("sampler", "independent", props));
+    const TriangleSet set{ *rng, 4096 };
+
+    std::vector<Ray> rays;
+    for (int i = 0; i < 4096; i++)
+        rays.push_back(randomRay(*rng));
+    const float tested = float(rays.size()) * set.triangles.size();
+
+    int scalarHits = 0;
+    Timer scalarTimer;
+    for (const Ray &ray : rays) {
+        for (const PrecomputedTriangle &triangle : set.triangles) {
+            float t;
+            Vector2 barycentric;
+            scalarHits += triangle.intersect(ray, Infinity, t, barycentric);
+        }
+    }
+    const float scalarTime = scalarTimer.getElapsedTime();
+
+    int packetHits = 0;
+    Timer packetTimer;
+    for (const Ray &ray : rays) {
+        for (const TrianglePacket &packet : set.packets) {
+            float t[TrianglePacket::Width], u[TrianglePacket::Width],
+                v[TrianglePacket::Width];
+            packetHits +=
+                std::popcount(unsigned(packet.test(ray, Infinity, t, u, v)));
+        }
+    }
+    const float packetTime = packetTimer.getElapsedTime();
+
+    logger(EInfo,
+           "scalar: %.1f Mtris/s, packets of %d: %.1f Mtris/s",
+           tested / scalarTime * 1e-6f,
+           TrianglePacket::Width,
+           tested / packetTime * 1e-6f);
+    // rounding can differ for rays that graze triangle edges
+    REQUIRE( packetHits == Catch::Approx(scalarHits).epsilon(1e-3) );
+}